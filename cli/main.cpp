@@ -0,0 +1,572 @@
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "desktopindex.h"
+#include "icontheme.h"
+#include "matcher.h"
+#include "windowitems.h"
+#include "windowmodel.h"
+#include "windowsearch.h"
+#include "xerrorfilter.h"
+
+/*
+ * Headless front end of the window switcher engine. Runs the same code as
+ * the plugin without the launcher, for profiling (perf, valgrind) and
+ * scripted regression runs. Results go to stdout, timings to stderr.
+ */
+
+using namespace std;
+using namespace XWindowSwitcher;
+
+#define FALLBACK_ICON "preferences-system"
+#define INITIAL_SNAPSHOT_TIMEOUT 2000
+#define SYNTHETIC_WINDOWS 1000
+#define PARSE_FIXED_COST 4096           // Bytes a file open costs about as much as
+#define PARSE_CLIFF_FACTOR 25           // Relative cost of a file that counts as a cliff
+#define PARSE_CLIFF_MINIMUM 1000000     // ns, faster files are never cliffs
+#define PARSE_RETRIES 3
+
+namespace {
+
+    atomic<bool> countingAllocations{false};
+    atomic<quint64> allocations{0};
+}
+
+#ifdef __GLIBC__
+/*
+ * Counts heap allocations while enabled. Qt allocates string and container
+ * data with malloc, so interposing malloc rather than operator new sees all
+ * of it.
+ */
+extern "C" {
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *pointer, size_t size);
+
+    void *malloc(size_t size) noexcept {
+        if(countingAllocations.load(memory_order_relaxed)) {
+            allocations.fetch_add(1, memory_order_relaxed);
+        }
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size) noexcept {
+        if(countingAllocations.load(memory_order_relaxed)) {
+            allocations.fetch_add(1, memory_order_relaxed);
+        }
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *pointer, size_t size) noexcept {
+        if(countingAllocations.load(memory_order_relaxed)) {
+            allocations.fetch_add(1, memory_order_relaxed);
+        }
+        return __libc_realloc(pointer, size);
+    }
+}
+#define CAN_COUNT_ALLOCATIONS true
+#else
+#define CAN_COUNT_ALLOCATIONS false
+#endif
+
+namespace {
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QString iconThemeName = "hicolor";
+
+    int usage() {
+        err << "Usage: xwindowswitcher-cli [options] <command>\n"
+               "\n"
+               "Commands:\n"
+               "  list              List the windows\n"
+               "  query <text>      Match the windows against a query\n"
+               "  activate <id>     Activate a window, the id may be given in hex\n"
+               "  reindex           Scan the application dirs\n"
+               "  parse <dir>...    Parse all desktop files below the dirs and report the\n"
+               "                    throughput, fails on files that take disproportionately\n"
+               "                    long for their size. See fuzz/generate_corpus.py\n"
+               "  budget <text>     Count the heap allocations of a warmed up query, fails\n"
+               "                    if they exceed --budget. Uses synthetic windows\n"
+               "                    unless --windows is given\n"
+               "\n"
+               "Options:\n"
+               "  --windows <file>  Read the windows from a file instead of the display,\n"
+               "                    one per line: id<TAB>class<TAB>title[<TAB>pid]\n"
+               "  --synthetic <n>   Use n generated windows instead of the display\n"
+               "  --settings <file> Plugin settings in ini format, e.g. groupByClass=true\n"
+               "  --repeat <n>      Run the query n times\n"
+               "  --icon-theme <name>\n"
+               "                    Resolve icons through this theme, defaults to hicolor\n"
+               "  --fuzzy <n>       Allow n edits in fuzzy matches, up to 3\n"
+               "  --time-budget <ms>\n"
+               "                    Fail the query if a run takes longer on average\n"
+               "  --budget <q>,<w>  Allocations allowed per query and per window, without\n"
+               "                    it they are only reported\n" << flush;
+        return 2;
+    }
+
+    void printTiming(const QString &phase, qint64 nsecs) {
+        err << QString("%1: %2 ms").arg(phase).arg(nsecs / 1e6, 0, 'f', 3) << endl;
+    }
+
+    shared_ptr<const WindowSnapshot> readWindows(const QString &path) {
+        QFile file(path);
+        if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            err << "Cannot open " << path << endl;
+            return nullptr;
+        }
+
+        auto snapshot = make_shared<WindowSnapshot>();
+        snapshot->generation = 1;
+        QTextStream stream(&file);
+        for(QString line = stream.readLine(); !line.isNull(); line = stream.readLine()) {
+            QStringList fields = line.split('\t');
+            if(fields.size() < 3) {
+                continue;
+            }
+            WindowRecord record;
+            record.window = fields[0].toULong(nullptr, 0);
+            record.windowClass = fields[1];
+            record.title = fields[2];
+            record.lowerClass = record.windowClass.toLower();
+            record.foldedClass = FoldedText::fold(record.windowClass);
+            record.foldedTitle = FoldedText(record.title);
+            record.pid = fields.size() > 3 ? fields[3].toInt() : 0;
+            record.stackingIndex = static_cast<int>(snapshot->windows.size());
+            snapshot->windows.push_back(record);
+        }
+        return snapshot;
+    }
+
+    // A fixed window set, owned by this process so that pid resolution gets exercised
+    shared_ptr<const WindowSnapshot> syntheticWindows(int count) {
+        static const char *const classes[] = {"firefox", "konsole", "code", "dolphin", "thunderbird", "gimp", "okular", "libreoffice"};
+        const int classCount = static_cast<int>(sizeof(classes) / sizeof(classes[0]));
+
+        auto snapshot = make_shared<WindowSnapshot>();
+        snapshot->generation = 1;
+        snapshot->windows.reserve(static_cast<size_t>(count));
+        for(int i = 0; i < count; i++) {
+            WindowRecord record;
+            record.window = 0x04000000 + static_cast<Window>(i);
+            record.windowClass = QString(classes[i % classCount]);
+            record.title = QString("Document %1 – Édition %2").arg(i).arg(classes[(i / classCount) % classCount]);
+            record.lowerClass = record.windowClass.toLower();
+            record.foldedClass = FoldedText::fold(record.windowClass);
+            record.foldedTitle = FoldedText(record.title);
+            record.pid = static_cast<pid_t>(QCoreApplication::applicationPid());
+            record.stackingIndex = i;
+            snapshot->windows.push_back(record);
+        }
+        return snapshot;
+    }
+
+    shared_ptr<const WindowSnapshot> fetchWindows(WindowModel *model) {
+        if(!model->open()) {
+            err << "Cannot open display" << endl;
+            return nullptr;
+        }
+
+        // The event thread publishes the initial state right after it started
+        QElapsedTimer timer;
+        timer.start();
+        while(model->snapshot()->generation == 0 && timer.elapsed() < INITIAL_SNAPSHOT_TIMEOUT) {
+            QThread::msleep(1);
+        }
+        return model->snapshot();
+    }
+
+    shared_ptr<const IconTheme> reindex(DesktopIndex *index) {
+        QElapsedTimer timer;
+        timer.start();
+        auto iconTheme = make_shared<const IconTheme>(iconThemeName, FALLBACK_ICON);
+        printTiming(QString("icon theme %1").arg(iconTheme->name()), timer.nsecsElapsed());
+        QStringList xdgAppDirs = QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation);
+        IndexUpdate update = DesktopIndex::scan(xdgAppDirs, QStringList(), iconTheme, QHash<QString, qint64>());
+        printTiming("scan", update.scanTime);
+        printTiming("parse", update.parseTime);
+        index->apply(std::move(update));
+        printTiming(QString("reindex (%1 entries)").arg(index->size()), timer.nsecsElapsed());
+        return iconTheme;
+    }
+
+    qint64 timeParse(const QString &path, const QString &id, const IconTheme &iconTheme, const QStringList &locales) {
+        QElapsedTimer timer;
+        timer.start();
+        DesktopIndex::parse(path, id, 0, 0, iconTheme, locales);
+        return timer.nsecsElapsed();
+    }
+
+    /*
+     * Parses corpora like the generated one, a crash fails the run as well.
+     * The cost of a file is its parse time relative to its size plus the
+     * fixed cost of opening it. Files far above the median cost are timed
+     * again before they count as a cliff, to rule out scheduling noise.
+     */
+    int parse(const QStringList &dirs) {
+        struct FileTiming {
+            QString path;
+            QString id;
+            qint64 size;
+            qint64 nsecs;
+            double cost() const { return double(nsecs) / (size + PARSE_FIXED_COST); }
+        };
+
+        const IconTheme iconTheme(iconThemeName, FALLBACK_ICON);
+        const QStringList locales = DesktopIndex::localeKeys();
+        vector<FileTiming> timings;
+        qint64 bytes = 0;
+        qint64 total = 0;
+        for(const QString &dir : dirs) {
+            QDirIterator it(dir, QStringList("*.desktop"), QDir::Files, QDirIterator::Subdirectories);
+            while(it.hasNext()) {
+                const QString path = it.next();
+                FileTiming timing{path, it.fileName(), it.fileInfo().size(), 0};
+                timing.nsecs = timeParse(path, timing.id, iconTheme, locales);
+                bytes += timing.size;
+                total += timing.nsecs;
+                timings.push_back(timing);
+            }
+        }
+        if(timings.empty()) {
+            err << "No desktop files" << endl;
+            return 1;
+        }
+
+        out << QString("%1 files, %2 MB in %3 ms: %4 files/s, %5 MB/s")
+               .arg(timings.size()).arg(bytes / 1e6, 0, 'f', 1).arg(total / 1e6, 0, 'f', 1)
+               .arg(timings.size() / (total / 1e9), 0, 'f', 0).arg(bytes / 1e6 / (total / 1e9), 0, 'f', 1) << endl;
+
+        vector<double> costs;
+        costs.reserve(timings.size());
+        for(const FileTiming &timing : timings) {
+            costs.push_back(timing.cost());
+        }
+        nth_element(costs.begin(), costs.begin() + costs.size() / 2, costs.end());
+        const double median = costs[costs.size() / 2];
+        out << QString("median: %1 us per 4 kB").arg(median * 4096 / 1e3, 0, 'f', 2) << endl;
+
+        sort(timings.begin(), timings.end(), [](const FileTiming &a, const FileTiming &b) { return a.cost() > b.cost(); });
+        int cliffs = 0;
+        for(FileTiming &timing : timings) {
+            if(timing.cost() <= median * PARSE_CLIFF_FACTOR || timing.nsecs < PARSE_CLIFF_MINIMUM) {
+                continue;
+            }
+            for(int retry = 0; retry < PARSE_RETRIES; retry++) {
+                timing.nsecs = qMin(timing.nsecs, timeParse(timing.path, timing.id, iconTheme, locales));
+            }
+            if(timing.cost() > median * PARSE_CLIFF_FACTOR && timing.nsecs >= PARSE_CLIFF_MINIMUM) {
+                err << QString("Cliff: %1 (%2 bytes) took %3 ms, %4x the median")
+                       .arg(timing.path).arg(timing.size).arg(timing.nsecs / 1e6, 0, 'f', 2)
+                       .arg(timing.cost() / median, 0, 'f', 0) << endl;
+                cliffs++;
+            }
+        }
+
+        sort(timings.begin(), timings.end(), [](const FileTiming &a, const FileTiming &b) { return a.cost() > b.cost(); });
+        for(size_t i = 0; i < qMin(timings.size(), size_t(5)); i++) {
+            out << QString("slowest: %1 (%2 bytes, %3 ms)").arg(timings[i].path).arg(timings[i].size).arg(timings[i].nsecs / 1e6, 0, 'f', 3) << endl;
+        }
+        return cliffs == 0 ? 0 : 1;
+    }
+
+    // A result and its item, built like in the plugin
+    struct Result {
+        const Hit *hit;     // The representative of a group
+        size_t windows;     // 1 unless grouped by class
+        shared_ptr<Core::Item> item;
+    };
+
+    // Everything a query needs besides the windows, as the plugin keeps it
+    struct Engine {
+        WindowSearch search;
+        shared_ptr<const Matcher> matcher;
+        shared_ptr<const IndexSnapshot> index;
+        HitList hits;
+        shared_ptr<const DisplayConnection> connection;     // None, the items are never activated
+
+        Engine(const QString &settingsFile, int fuzzyDistance) {
+            DesktopIndex desktopIndex;
+            search.setIconTheme(reindex(&desktopIndex));
+            index = make_shared<IndexSnapshot>(desktopIndex);
+
+            // Compiled from settings like in the plugin, the overrides go to a throwaway copy
+            QTemporaryFile file;
+            if(!file.open()) {
+                matcher = make_shared<Matcher>();
+                return;
+            }
+            QSettings settings(file.fileName(), QSettings::IniFormat);
+            if(!settingsFile.isNull()) {
+                QSettings given(settingsFile, QSettings::IniFormat);
+                for(const QString &key : given.allKeys()) {
+                    settings.setValue(key, given.value(key));
+                }
+            }
+            if(fuzzyDistance > 0) {
+                settings.setValue(Matcher::CFG_FUZZY_DISTANCE, fuzzyDistance);
+            }
+            matcher = make_shared<Matcher>(settings);
+        }
+
+        // Same steps as the plugin per query, including the items
+        vector<Result> match(const shared_ptr<const WindowSnapshot> &windows, const QString &text) {
+            SearchContext context;
+            context.matcher = matcher;
+            context.index = index;
+            context.windows = SnapshotList{windows};
+            context.setQuery(text);
+            hits = search.search(context);
+
+            vector<Result> results;
+            if(matcher->groupByClass()) {
+                vector<HitGroup> groups = WindowSearch::group(hits, *matcher);
+                results.reserve(groups.size());
+                for(const HitGroup &group : groups) {
+                    const Hit *best = WindowSearch::representative(group);
+                    QString iconPath = search.iconPath(*index, best->key, best->window->windowClass);
+                    results.push_back(Result{best, group.size(), group.size() == 1
+                                             ? makeWindowItem(*best, iconPath, connection)
+                                             : makeClassItem(*best, group.size(), iconPath, connection)});
+                }
+            } else {
+                results.reserve(hits.size());
+                for(const Hit &hit : hits) {
+                    QString iconPath = search.iconPath(*index, hit.key, hit.window->windowClass);
+                    results.push_back(Result{&hit, 1, makeWindowItem(hit, iconPath, connection)});
+                }
+            }
+
+            search.pidResolver().retain(context.windows);
+            return results;
+        }
+    };
+
+    int query(const shared_ptr<const WindowSnapshot> &windows, const QString &text, int repeat, const QString &settingsFile,
+              int fuzzyDistance, double timeBudget) {
+        Engine engine(settingsFile, fuzzyDistance);
+        vector<Result> results;
+        qint64 first = 0;
+        qint64 total = 0;
+
+        for(int run = 0; run < repeat; run++) {
+            QElapsedTimer timer;
+            timer.start();
+            results = engine.match(windows, text);
+            qint64 elapsed = timer.nsecsElapsed();
+            first = run == 0 ? elapsed : first;
+            total += elapsed;
+        }
+
+        for(const Result &result : results) {
+            const WindowRecord *window = result.hit->window;
+            out << QString("0x%1\t%2\t%3\t%4\t%5").arg(window->window, 8, 16, QChar('0')).arg(result.hit->score)
+                   .arg(result.windows).arg(window->windowClass, window->title) << endl;
+        }
+
+        printTiming(QString("query (%1 windows, %2 results, first run)").arg(windows->windows.size()).arg(results.size()), first);
+        if(repeat > 1) {
+            printTiming(QString("query (mean of %1 runs)").arg(repeat), total / repeat);
+        }
+
+        // The first run is left out, it fills the pid resolver cache
+        qint64 mean = repeat > 1 ? (total - first) / (repeat - 1) : first;
+        if(timeBudget > 0 && mean > timeBudget * 1e6) {
+            err << QString("Time budget of %1 ms exceeded").arg(timeBudget) << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Mean allocations of a query over the given windows
+    double countAllocations(Engine *engine, const shared_ptr<const WindowSnapshot> &windows, const QString &text, int repeat) {
+        allocations = 0;
+        countingAllocations = true;
+        for(int run = 0; run < repeat; run++) {
+            engine->match(windows, text);
+        }
+        countingAllocations = false;
+        return double(allocations.load()) / repeat;
+    }
+
+    /*
+     * Guards the query path against heap churn creeping back in. Runs the
+     * engine and builds the items like the plugin does, see Engine::match.
+     * Thumbnails are left out, the plugin only looks them up. A query over the
+     * windows twice over costs the per window part once more, the per query
+     * part including the fan-out to the match pool cancels out. The copies
+     * keep the window ids, so that the pid resolver cache stays warm.
+     */
+    int budget(const shared_ptr<const WindowSnapshot> &windows, const QString &text, int repeat, const QString &settingsFile,
+               int fuzzyDistance, double queryBudget, double windowBudget) {
+        if(!CAN_COUNT_ALLOCATIONS) {
+            err << "Counting allocations needs glibc" << endl;
+            return 1;
+        }
+        if(windows->windows.empty()) {
+            err << "No windows" << endl;
+            return 1;
+        }
+
+        auto doubled = make_shared<WindowSnapshot>(*windows);
+        doubled->windows.insert(doubled->windows.end(), windows->windows.begin(), windows->windows.end());
+        shared_ptr<const WindowSnapshot> twice = doubled;
+
+        // Warm up the pid resolver, the icon cache and whatever Qt builds lazily
+        Engine engine(settingsFile, fuzzyDistance);
+        engine.match(twice, text);
+        engine.match(windows, text);
+
+        double once = countAllocations(&engine, windows, text, repeat);
+        double perWindow = (countAllocations(&engine, twice, text, repeat) - once) / windows->windows.size();
+        double perQuery = once - perWindow * windows->windows.size();
+
+        out << QString("allocations per query: %1").arg(perQuery, 0, 'f', 2) << endl;
+        out << QString("allocations per window: %1").arg(perWindow, 0, 'f', 4) << endl;
+
+        // Negative if not given
+        if(queryBudget < 0) {
+            return 0;
+        }
+        out << QString("budget: %1 per query, %2 per window").arg(queryBudget).arg(windowBudget) << endl;
+        if(perQuery > queryBudget || perWindow > windowBudget) {
+            err << "Allocation budget exceeded" << endl;
+            return 1;
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char **argv) {
+    QCoreApplication app(argc, argv);
+    QStringList arguments = app.arguments().mid(1);
+
+    QString windowsFile;
+    QString settingsFile;
+    int synthetic = 0;
+    int repeat = 1;
+    double queryBudget = -1;
+    double windowBudget = -1;
+    int fuzzyDistance = 0;
+    double timeBudget = 0;
+    while(!arguments.isEmpty() && arguments.first().startsWith("--")) {
+        QString option = arguments.takeFirst();
+        if(option == "--windows" && !arguments.isEmpty()) {
+            windowsFile = arguments.takeFirst();
+        } else if(option == "--settings" && !arguments.isEmpty()) {
+            settingsFile = arguments.takeFirst();
+        } else if(option == "--synthetic" && !arguments.isEmpty()) {
+            synthetic = qMax(1, arguments.takeFirst().toInt());
+        } else if(option == "--repeat" && !arguments.isEmpty()) {
+            repeat = qMax(1, arguments.takeFirst().toInt());
+        } else if(option == "--icon-theme" && !arguments.isEmpty()) {
+            iconThemeName = arguments.takeFirst();
+        } else if(option == "--fuzzy" && !arguments.isEmpty()) {
+            fuzzyDistance = qBound(0, arguments.takeFirst().toInt(), static_cast<int>(Matcher::MAX_FUZZY_DISTANCE));
+        } else if(option == "--time-budget" && !arguments.isEmpty()) {
+            timeBudget = arguments.takeFirst().toDouble();
+        } else if(option == "--budget" && !arguments.isEmpty()) {
+            QStringList budgets = arguments.takeFirst().split(',');
+            bool queryOk = false, windowOk = false;
+            queryBudget = budgets.value(0).toDouble(&queryOk);
+            windowBudget = budgets.value(1).toDouble(&windowOk);
+            if(!queryOk || !windowOk || queryBudget < 0 || windowBudget < 0) {
+                return usage();
+            }
+        } else {
+            return usage();
+        }
+    }
+    if(arguments.isEmpty()) {
+        return usage();
+    }
+
+    const QString command = arguments.takeFirst();
+
+    if(command == "reindex") {
+        DesktopIndex index;
+        reindex(&index);
+        return 0;
+    }
+
+    if(command == "parse") {
+        if(arguments.isEmpty()) {
+            return usage();
+        }
+        return parse(arguments);
+    }
+
+    if(command == "activate") {
+        bool ok = false;
+        Window window = arguments.isEmpty() ? 0 : arguments.first().toULong(&ok, 0);
+        if(!ok) {
+            return usage();
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        Display *display = XOpenDisplay(NULL);
+        if(display == NULL) {
+            err << "Cannot open display" << endl;
+            return 1;
+        }
+        XErrorFilter::add(display);
+        WindowModel::activateWindow(display, window);
+        XErrorFilter::remove(display);
+        XCloseDisplay(display);
+        printTiming("activate", timer.nsecsElapsed());
+        return 0;
+    }
+
+    if(command != "list" && command != "query" && command != "budget") {
+        return usage();
+    }
+    if((command == "query" || command == "budget") && arguments.isEmpty()) {
+        return usage();
+    }
+    if(command == "budget" && windowsFile.isNull() && synthetic == 0) {
+        synthetic = SYNTHETIC_WINDOWS;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    WindowModel model;
+    shared_ptr<const WindowSnapshot> windows;
+    if(!windowsFile.isNull()) {
+        windows = readWindows(windowsFile);
+    } else if(synthetic != 0) {
+        windows = syntheticWindows(synthetic);
+    } else {
+        windows = fetchWindows(&model);
+    }
+    if(!windows) {
+        return 1;
+    }
+    printTiming(QString("windows (%1)").arg(windows->windows.size()), timer.nsecsElapsed());
+
+    if(command == "list") {
+        for(const WindowRecord &window : windows->windows) {
+            out << QString("0x%1\t%2\t%3\t%4").arg(window.window, 8, 16, QChar('0')).arg(window.pid).arg(window.windowClass, window.title) << endl;
+        }
+        return 0;
+    }
+
+    if(command == "budget") {
+        return budget(windows, arguments.join(' '), repeat, settingsFile, fuzzyDistance, queryBudget, windowBudget);
+    }
+
+    return query(windows, arguments.join(' '), repeat, settingsFile, fuzzyDistance, timeBudget);
+}
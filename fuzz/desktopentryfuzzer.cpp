@@ -0,0 +1,50 @@
+#include <QString>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include "desktopindex.h"
+#include "icontheme.h"
+
+/*
+ * libFuzzer target of the desktop entry parser and the Exec tokenizer. Every
+ * input is parsed as a desktop file and tokenized as an Exec value. Needs
+ * clang, configure with -DBUILD_FUZZER=ON and seed it with the generated
+ * corpus, e.g.
+ *
+ *   fuzz/generate_corpus.py corpus
+ *   xwindowswitcher-fuzzer -max_len=2000000 -timeout=5 corpus
+ */
+
+using namespace std;
+using namespace XWindowSwitcher;
+
+namespace {
+
+    unique_ptr<QTemporaryFile> file;
+    unique_ptr<IconTheme> iconTheme;
+    QStringList locales;
+}
+
+extern "C" int LLVMFuzzerInitialize(int *, char ***) {
+    file.reset(new QTemporaryFile);
+    if(!file->open()) {
+        abort();
+    }
+    iconTheme.reset(new IconTheme("hicolor", "preferences-system"));
+    locales = QStringList{"de_DE@euro", "de_DE", "de@euro", "de"};
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    // The parser reads from disk, one file gets rewritten for every input
+    file->resize(0);
+    file->seek(0);
+    file->write(reinterpret_cast<const char *>(data), static_cast<qint64>(size));
+    file->flush();
+    DesktopIndex::parse(file->fileName(), "fuzz.desktop", 0, 0, *iconTheme, locales);
+
+    DesktopIndex::tokenizeExec(QString::fromUtf8(reinterpret_cast<const char *>(data), static_cast<int>(size)));
+    return 0;
+}
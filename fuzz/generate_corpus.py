@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""
+Generates a corpus of desktop files for the parser fuzzer and the parse
+throughput run of xwindowswitcher-cli. Most files look like the ones shipped
+by distributions, Flatpak and Snap, the rest are adversarial: huge lines,
+odd encodings, broken syntax and deeply nested directories. The output is
+deterministic for a given seed and count.
+
+    generate_corpus.py [--count N] [--seed S] <output dir>
+"""
+
+import argparse
+import os
+import random
+import shutil
+
+NAMES = ["Firefox", "Thunderbird", "Konsole", "Dolphin", "GIMP", "Inkscape", "LibreOffice Writer",
+         "Visual Studio Code", "Okular", "VLC media player", "Steam", "Signal", "Zoom", "Files",
+         "Text Editor", "Système", "Éditeur d'images", "Терминал", "文本编辑器", "ファイル"]
+LOCALES = ["de", "de_DE", "fr", "fr_CA", "ru", "zh_CN", "ja", "sr@latin", "pt_BR", "es"]
+CATEGORIES = ["Network;WebBrowser;", "Utility;TextEditor;", "Graphics;2DGraphics;", "System;TerminalEmulator;",
+              "Office;WordProcessor;", "AudioVideo;Player;", "Game;", "Development;IDE;"]
+FIELD_CODES = ["%u", "%U", "%f", "%F", "%i %c %k", ""]
+ICONS = ["firefox", "utilities-terminal", "org.gnome.Nautilus", "/usr/share/pixmaps/app.png",
+         "/snap/foo/current/icon.svg", "missing-icon-name", "app.png", ""]
+
+# Files above 1 MB are skipped by the parser, a few of them check just that
+MAX_FILE_SIZE = 1024 * 1024
+
+
+def program(rng):
+    name = rng.choice(["firefox", "thunderbird", "konsole", "code", "gimp-2.10", "vlc", "my app", "python3"])
+    return rng.choice([
+        name,
+        "/usr/bin/" + name,
+        '"/opt/%s/bin/%s"' % (name, name),
+        "env BAMF_DESKTOP_FILE_HINT=/var/lib/snapd/desktop/applications/%s.desktop /snap/bin/%s" % (name, name),
+        "env GDK_BACKEND=x11 LANG=C %s" % name,
+        "/usr/bin/flatpak run --branch=stable --arch=x86_64 --command=%s org.example.%s" % (name, name.title()),
+        "python3 /usr/share/%s/%s.py" % (name, name),
+        "java -jar /opt/%s/%s.jar" % (name, name),
+        'sh -c "%s --new-window \\\\"$HOME\\\\""' % name,
+        "/usr/bin/%s\\s--flag" % name,
+    ])
+
+
+def realistic(rng):
+    lines = []
+    if rng.random() < 0.1:
+        lines.append("# Generated by a package manager")
+    lines.append("[Desktop Entry]")
+    lines.append("Version=1.0")
+    lines.append("Type=" + rng.choice(["Application"] * 8 + ["Link", "Directory"]))
+    name = rng.choice(NAMES)
+    lines.append("Name=" + name)
+    for locale in rng.sample(LOCALES, rng.randint(0, len(LOCALES))):
+        lines.append("Name[%s]=%s %s" % (locale, name, locale))
+    if rng.random() < 0.7:
+        lines.append("GenericName=" + rng.choice(["Web Browser", "Terminal", "Image Editor", "Mail Client"]))
+    if rng.random() < 0.6:
+        lines.append("Keywords=" + ";".join(rng.sample(["web", "internet", "shell", "prompt", "photo", "mail", "edit"], 3)) + ";")
+    lines.append("Exec=%s %s" % (program(rng), rng.choice(FIELD_CODES)))
+    if rng.random() < 0.3:
+        lines.append("TryExec=" + program(rng).split(" ")[0])
+    icon = rng.choice(ICONS)
+    if icon or rng.random() < 0.5:
+        lines.append("Icon=" + icon)
+    if rng.random() < 0.3:
+        lines.append("StartupWMClass=" + rng.choice(["Firefox", "org.gnome.Nautilus", "code-oss", "steam_app_1234"]))
+    if rng.random() < 0.05:
+        lines.append("NoDisplay=true")
+    if rng.random() < 0.03:
+        lines.append("Hidden=true")
+    lines.append("Categories=" + rng.choice(CATEGORIES))
+    lines.append("Terminal=false")
+    for action in range(rng.choice([0, 0, 1, 3])):
+        lines.append("")
+        lines.append("[Desktop Action action%d]" % action)
+        lines.append("Name=Action %d" % action)
+        lines.append("Exec=%s --action %d" % (program(rng), action))
+    newline = rng.choice(["\n"] * 9 + ["\r\n"])
+    return (newline.join(lines) + newline).encode("utf-8")
+
+
+def adversarial(rng, huge):
+    kind = rng.randrange(14)
+    header = b"[Desktop Entry]\nType=Application\n"
+    if kind == 0:
+        # One huge line, just below or above the size limit when huge
+        length = MAX_FILE_SIZE + rng.choice([-4096, 4096]) if huge else rng.randint(1000, 20000)
+        key = rng.choice([b"Name=", b"Exec=", b"Keywords=", b"Icon=", b""])
+        return header + key + bytes(rng.choices(b"a\"\\; %=[]", k=length)) + b"\n"
+    if kind == 1:
+        # Quotes and escapes the tokenizer has to walk through
+        pattern = rng.choice([b'"', b'\\', b'\\"', b'"\\\\', b'\\s', b'%%'])
+        return header + b"Name=Quotes\nIcon=q\nExec=" + pattern * rng.randint(100, 200000 if huge else 5000) + b"\n"
+    if kind == 2:
+        # Many keys
+        return header + b"".join(b"Name[x%d]=n%d\n" % (i, i) for i in range(rng.randint(100, 40000 if huge else 1000)))
+    if kind == 3:
+        # Latin-1 and invalid UTF-8
+        return header + b"Name=Syst\xe8me \xff\xfe\xc3\x28 \xed\xa0\x80\nExec=/usr/bin/\xe9\nIcon=\xc0\xaf\n"
+    if kind == 4:
+        # UTF-16 with BOM
+        return realistic(rng).decode("utf-8").encode("utf-16")
+    if kind == 5:
+        # NUL bytes and control characters
+        return header + b"Name=a\x00b\x01c\nExec=\x00/usr/bin/x\x00 %u\nIcon=\x7f\n"
+    if kind == 6:
+        # Lone carriage returns, no newline at all
+        return realistic(rng).replace(b"\n", b"\r")
+    if kind == 7:
+        # Broken groups and keys
+        return (b"[Desktop Entry\nType=Application\n[Desktop Entry]]\nName[=x\nName]=y\n=\nExec\nExec==\n"
+                b"Icon=[\nStartupWMClass=\n[Desktop Entry]\nName[de=z\n")
+    if kind == 8:
+        # Unterminated quote followed by everything else
+        return header + b"Name=U\nIcon=u\nExec=\"/usr/bin/unterminated --arg " + b"x " * rng.randint(10, 1000) + b"\n"
+    if kind == 9:
+        # Only env assignments, no program
+        return header + b"Name=Env\nIcon=e\nExec=env " + b"A=1 " * rng.randint(1, 2000) + b"\n"
+    if kind == 10:
+        # Empty and whitespace only
+        return rng.choice([b"", b"\n", b" \t\r\n" * 100])
+    if kind == 11:
+        # Random bytes
+        return bytes(rng.getrandbits(8) for _ in range(rng.randint(1, 65536 if huge else 2048)))
+    if kind == 12:
+        # Combining marks and wide characters the folding has to handle
+        text = "".join(rng.choice(["é", "ẞ", "ﬁ", "\U0001f600", "İ", "ä̈̈"]) for _ in range(rng.randint(10, 1000)))
+        return (header.decode() + "Name=" + text + "\nKeywords=" + text + ";\nExec=x\nIcon=x\n").encode("utf-8")
+    # A realistic file truncated at a random point
+    data = realistic(rng)
+    return data[:rng.randrange(len(data) + 1)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("output")
+    parser.add_argument("--count", type=int, default=30000)
+    parser.add_argument("--seed", type=int, default=1)
+    arguments = parser.parse_args()
+
+    rng = random.Random(arguments.seed)
+    shutil.rmtree(arguments.output, ignore_errors=True)
+    os.makedirs(arguments.output)
+
+    # Flat like /usr/share/applications, a few vendor subdirs, and some very deep paths
+    directories = [arguments.output]
+    for vendor in ["kde4", "wine/Programs/Vendor", "org.example"]:
+        directories.append(os.path.join(arguments.output, vendor))
+    deep = arguments.output
+    for level in range(64):
+        deep = os.path.join(deep, "d%d" % level)
+        if level % 8 == 7:
+            directories.append(deep)
+    for directory in directories:
+        os.makedirs(directory, exist_ok=True)
+
+    for i in range(arguments.count):
+        if i % 5 == 0:
+            data = adversarial(rng, huge=i % 1500 == 0)
+        else:
+            data = realistic(rng)
+        directory = directories[0] if rng.random() < 0.8 else rng.choice(directories)
+        with open(os.path.join(directory, "app%06d.desktop" % i), "wb") as file:
+            file.write(data)
+
+
+if __name__ == "__main__":
+    main()
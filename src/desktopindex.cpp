@@ -0,0 +1,745 @@
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <climits>
+#include <cstring>
+#include <dirent.h>
+#include <map>
+#include <sys/stat.h>
+#include "desktopindex.h"
+#include "foldedtext.h"
+#include "icontheme.h"
+
+using namespace std;
+
+#define CACHE_MAGIC 0x58575349
+#define CACHE_VERSION 9
+#define MAX_FILE_SIZE (1024 * 1024)     // Real desktop files are a few kB
+
+namespace {
+
+    // An application dir, priority is its index in the configured list, lower wins
+    struct Root {
+        QString path;
+        int priority;
+    };
+
+    // A desktop file found by the walk, not parsed yet
+    struct FoundFile {
+        QString path;
+        QString id;
+        int priority;
+        qint64 modified;
+    };
+
+    qint64 modificationTime(const struct stat &status) {
+        return qint64(status.st_mtim.tv_sec) * 1000 + status.st_mtim.tv_nsec / 1000000;
+    }
+
+    /*
+     * The roots that exist, each directory once. Flatpak and Snap export dirs
+     * often resolve to the same place, the one listed first wins.
+     */
+    QList<Root> uniqueRoots(const QStringList &roots) {
+        QList<Root> unique;
+        QSet<QString> canonicalPaths;
+        for(int i = 0; i < roots.size(); i++) {
+            QString canonicalPath = QFileInfo(roots[i]).canonicalFilePath();
+            if(!canonicalPath.isEmpty() && !canonicalPaths.contains(canonicalPath)) {
+                canonicalPaths.insert(canonicalPath);
+                unique.append(Root{roots[i], i});
+            }
+        }
+        return unique;
+    }
+
+    const Root *rootOf(const QString &path, const QList<Root> &roots) {
+        for(const Root &root : roots) {
+            if(path == root.path || (path.startsWith(root.path) && path.at(root.path.size()) == '/')) {
+                return &root;
+            }
+        }
+        return nullptr;
+    }
+
+    /*
+     * Collects the desktop files below dir. readdir fetches the entries in
+     * bulk and reports their type, so only symlinks and desktop files need a
+     * stat. Directories visited before, e.g. through a symlink, are skipped.
+     * Hidden files and directories are ignored.
+     */
+    void walk(const QString &dir, const QString &idPrefix, int priority, QSet<QPair<quint64, quint64>> *visited, QList<FoundFile> *files) {
+        DIR *stream = opendir(QFile::encodeName(dir).constData());
+        if(stream == nullptr) {
+            return;
+        }
+
+        int fd = dirfd(stream);
+        struct stat status;
+        if(fstat(fd, &status) != 0) {
+            closedir(stream);
+            return;
+        }
+        QPair<quint64, quint64> inode(status.st_dev, status.st_ino);
+        if(visited->contains(inode)) {
+            closedir(stream);
+            return;
+        }
+        visited->insert(inode);
+
+        QStringList subdirs;
+        while(dirent *entry = readdir(stream)) {
+            const char *name = entry->d_name;
+            if(name[0] == '.') {
+                continue;
+            }
+
+            // Symlinks are followed, some filesystems do not report types at all
+            unsigned char type = entry->d_type;
+            bool stated = false;
+            if(type == DT_LNK || type == DT_UNKNOWN) {
+                if(fstatat(fd, name, &status, 0) != 0) {
+                    continue;
+                }
+                stated = true;
+                type = S_ISDIR(status.st_mode) ? DT_DIR : S_ISREG(status.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+
+            size_t length = strlen(name);
+            if(type == DT_DIR) {
+                subdirs << QFile::decodeName(name);
+            } else if(type == DT_REG && length > 8 && strcmp(name + length - 8, ".desktop") == 0
+                      && (stated || fstatat(fd, name, &status, 0) == 0)) {
+                QString fileName = QFile::decodeName(name);
+                files->append(FoundFile{dir + '/' + fileName, idPrefix + fileName, priority, modificationTime(status)});
+            }
+        }
+        closedir(stream);
+
+        // Descend after closing, deep trees do not pile up open descriptors then
+        for(const QString &subdir : subdirs) {
+            walk(dir + '/' + subdir, idPrefix + subdir + '-', priority, visited, files);
+        }
+    }
+
+    /*
+     * Index of the program in the tokens of an Exec value. A leading env
+     * invocation and its NAME=value assignments are skipped, as in the Exec
+     * lines of Snap packages. Equals the size if there is no program.
+     */
+    int programIndex(const QStringList &tokens) {
+        int index = 0;
+        if(!tokens.isEmpty() && (tokens[0] == "env" || tokens[0].endsWith("/env"))) {
+            for(index = 1; index < tokens.size() && tokens[index].contains('='); index++);
+        }
+        return index;
+    }
+
+    /*
+     * Canonical path of the program started by an Exec or TryExec value, as
+     * /proc/<pid>/exe or cmdline of the running process would report it.
+     */
+    QString resolveExecutable(const QString &command) {
+        QStringList tokens = XWindowSwitcher::DesktopIndex::tokenizeExec(command);
+
+        int index = programIndex(tokens);
+        if(index >= tokens.size()) {
+            return QString();
+        }
+
+        // Interpreters are shared by many applications, the script (or jar)
+        // passed to them identifies the application instead
+        for(int i = index + 1; i < tokens.size() && i <= index + 3; i++) {
+            if(tokens[i].startsWith('/') && QFileInfo(tokens[i]).isFile()) {
+                return QFileInfo(tokens[i]).canonicalFilePath();
+            } else if(!tokens[i].startsWith('-')) {
+                break;
+            }
+        }
+
+        QString program = tokens[index];
+        if(!program.startsWith('/')) {
+            program = QStandardPaths::findExecutable(program);
+        }
+        return program.isEmpty() ? QString() : QFileInfo(program).canonicalFilePath();
+    }
+
+    /*
+     * A localized value, remembers the rank of the locale it was taken from so
+     * that better matches found later in the file replace it.
+     */
+    struct LocalizedValue {
+        QString value;
+        int rank = INT_MAX;
+
+        void offer(const QString &locale, const QString &candidate, const QStringList &locales) {
+            int candidateRank = locale.isNull() ? locales.size() : locales.indexOf(locale);
+            if(candidateRank != -1 && candidateRank < rank) {
+                value = candidate;
+                rank = candidateRank;
+            }
+        }
+    };
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::IndexUpdate XWindowSwitcher::DesktopIndex::scan(const QStringList &roots, const QStringList &paths, const shared_ptr<const IconTheme> &iconTheme,
+                                                                 const QHash<QString, qint64> &known) {
+    IndexUpdate update;
+    QStringList locales = localeKeys();
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<Root> unique = uniqueRoots(roots);
+    QSet<QPair<quint64, quint64>> visited;
+    QList<FoundFile> files;
+
+    if(paths.isEmpty()) {
+        update.complete = true;
+        for(const Root &root : unique) {
+            walk(root.path, QString(), root.priority, &visited, &files);
+        }
+        update.scanTime = timer.nsecsElapsed();
+
+        QSet<QString> seen;
+        seen.reserve(files.size());
+        for(const FoundFile &file : files) {
+            seen.insert(file.path);
+
+            auto it = known.find(file.path);
+            if(it == known.end() || it.value() != file.modified) {
+                update.removed.append(file.path);
+                update.entries.append(parse(file.path, file.id, file.priority, file.modified, *iconTheme, locales));
+            }
+        }
+
+        for(auto it = known.begin(); it != known.end(); ++it) {
+            if(!seen.contains(it.key())) {
+                update.removed.append(it.key());
+            }
+        }
+        update.parseTime = timer.nsecsElapsed() - update.scanTime;
+        return update;
+    }
+
+    for(const QString &path : paths) {
+        update.removed.append(path);
+
+        const Root *root = rootOf(path, unique);
+        struct stat status;
+        if(root == nullptr || stat(QFile::encodeName(path).constData(), &status) != 0) {
+            continue;
+        }
+
+        // The id is the path relative to the root with '/' turned into '-'
+        QString id = path.mid(root->path.size() + 1).replace('/', '-');
+        if(S_ISDIR(status.st_mode)) {
+            walk(path, id.isEmpty() ? id : id + '-', root->priority, &visited, &files);
+        } else if(S_ISREG(status.st_mode) && path.endsWith(".desktop")) {
+            files.append(FoundFile{path, id, root->priority, modificationTime(status)});
+        }
+    }
+    update.scanTime = timer.nsecsElapsed();
+
+    for(const FoundFile &file : files) {
+        update.entries.append(parse(file.path, file.id, file.priority, file.modified, *iconTheme, locales));
+    }
+    update.parseTime = timer.nsecsElapsed() - update.scanTime;
+
+    return update;
+}
+
+
+
+/** ***************************************************************************/
+QStringList XWindowSwitcher::DesktopIndex::tokenizeExec(const QString &value) {
+    // Escapes of string values first, \s \n \t \r and \\ are defined
+    QString unescaped;
+    unescaped.reserve(value.size());
+    for(int i = 0; i < value.size(); i++) {
+        if(value[i] != '\\' || i + 1 == value.size()) {
+            unescaped.append(value[i]);
+            continue;
+        }
+        switch(value[++i].unicode()) {
+            case 's': unescaped.append(' '); break;
+            case 'n': unescaped.append('\n'); break;
+            case 't': unescaped.append('\t'); break;
+            case 'r': unescaped.append('\r'); break;
+            case '\\': unescaped.append('\\'); break;
+            default: unescaped.append('\\').append(value[i]); break;
+        }
+    }
+
+    /*
+     * Then the quoting of the Exec key. Arguments are separated by unquoted
+     * whitespace, inside double quotes a backslash escapes the next character.
+     * Malformed values (e.g. an unterminated quote) are split as far as they
+     * go, there is no way to recover what was meant.
+     */
+    QStringList tokens;
+    QString token;
+    bool quoted = false;
+    bool inToken = false;
+    for(int i = 0; i < unescaped.size(); i++) {
+        const QChar c = unescaped[i];
+        if(quoted) {
+            if(c == '"') {
+                quoted = false;
+            } else if(c == '\\' && i + 1 < unescaped.size()) {
+                token.append(unescaped[++i]);
+            } else {
+                token.append(c);
+            }
+        } else if(c == '"') {
+            quoted = true;
+            inToken = true;
+        } else if(c.isSpace()) {
+            if(inToken) {
+                tokens << token;
+                token.clear();
+                inToken = false;
+            }
+        } else {
+            token.append(c);
+            inToken = true;
+        }
+    }
+    if(inToken) {
+        tokens << token;
+    }
+
+    return tokens;
+}
+
+
+
+/** ***************************************************************************/
+QStringList XWindowSwitcher::DesktopIndex::localeKeys() {
+    // LC_MESSAGES has the form lang_COUNTRY.ENCODING@MODIFIER
+    QString messages;
+    for(const char *variable : {"LC_ALL", "LC_MESSAGES", "LANG"}) {
+        messages = QString::fromLocal8Bit(qgetenv(variable));
+        if(!messages.isEmpty()) {
+            break;
+        }
+    }
+    if(messages.isEmpty() || messages == "C" || messages == "POSIX") {
+        messages = QLocale().name();
+    }
+
+    QString modifier;
+    int index = messages.indexOf('@');
+    if(index != -1) {
+        modifier = messages.mid(index);
+        messages.truncate(index);
+    }
+    index = messages.indexOf('.');
+    if(index != -1) {
+        messages.truncate(index);
+    }
+
+    QString lang = messages.section('_', 0, 0);
+    QStringList keys;
+    if(messages != lang) {
+        if(!modifier.isEmpty()) {
+            keys << messages + modifier;
+        }
+        keys << messages;
+    }
+    if(!modifier.isEmpty()) {
+        keys << lang + modifier;
+    }
+    if(!lang.isEmpty() && lang != "C") {
+        keys << lang;
+    }
+    return keys;
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::DesktopEntry XWindowSwitcher::DesktopIndex::parse(const QString &path, const QString &id, int priority, qint64 modified,
+                                                                   const IconTheme &iconTheme, const QStringList &locales) {
+    DesktopEntry entry;
+    entry.id = id;
+    entry.path = path;
+    entry.priority = priority;
+    entry.modified = modified;
+
+    QString exec;
+    QString iconName;
+    QString iconPath;
+    QString startupWMClass;
+    QStringList nameTokens;
+    LocalizedValue name;
+    LocalizedValue genericName;
+    LocalizedValue keywords;
+    QStringList commands;
+    bool inMainGroup = false;
+    bool desktopEntry = false;
+    bool applicationType = false;
+    bool noDisplay = false;
+
+    /*
+     * Get the data from the desktop file
+     */
+
+    // Read the file into a map
+    {
+        QFile file(path);
+        if(file.size() > MAX_FILE_SIZE || !file.open(QIODevice::ReadOnly | QIODevice::Text))
+            return entry;
+        QTextStream stream(&file);
+        for(QString line = stream.readLine(); !line.isNull(); line = stream.readLine()) {
+            line = line.trimmed();
+
+            if(line.startsWith('[')) {
+                inMainGroup = line == "[Desktop Entry]";
+                desktopEntry = desktopEntry || inMainGroup;
+                continue;
+            }
+
+            // Actions have names, icons and commands of their own
+            if(!inMainGroup) {
+                continue;
+            }
+
+            // Localized keys
+            int separator = line.indexOf('=');
+            if(separator != -1) {
+                QString key = line.left(separator).trimmed();
+                QString locale;
+                int bracket = key.indexOf('[');
+                if(bracket != -1 && key.endsWith(']')) {
+                    locale = key.mid(bracket + 1, key.size() - bracket - 2);
+                    key.truncate(bracket);
+                }
+
+                if(key == "Name") {
+                    name.offer(locale, line.mid(separator + 1).trimmed(), locales);
+                } else if(key == "GenericName") {
+                    genericName.offer(locale, line.mid(separator + 1).trimmed(), locales);
+                } else if(key == "Keywords") {
+                    keywords.offer(locale, line.mid(separator + 1).trimmed(), locales);
+                } else if(key == "Exec" || key == "TryExec") {
+                    commands << line.mid(separator + 1).trimmed();
+                    if(key == "Exec" && exec.isNull()) {
+                        exec = commands.last();
+                    }
+                }
+            }
+
+            if(!applicationType && line.startsWith("Type=Application")) {
+                applicationType = true;
+            }
+
+            // Hidden=true marks the id as deleted, it shadows the entries below it all the same
+            if(!noDisplay && (line.startsWith("NoDisplay=true") || line.startsWith("Hidden=true"))) {
+                noDisplay = true;
+            }
+
+            if(line.startsWith("Icon")) {
+                int index = line.indexOf("=");
+                if(index != -1) {
+                    iconPath = line.mid(index + 1);
+                }
+
+            } else if(line.startsWith("StartupWMClass")) {
+                int index = line.indexOf("=");
+                if(index != -1) {
+                    startupWMClass = line.mid(index + 1);
+                }
+            } else if(nameTokens.isEmpty() && line.startsWith("Name") && !line.contains('[') && !line.contains(']')) {
+                int index = line.indexOf("=");
+                if(index != -1) {
+                    nameTokens = QString(line.mid(index + 1)).toLower().split(" ");
+                }
+            }
+        }
+        file.close();
+    }
+
+    if(!desktopEntry || !applicationType || noDisplay) {
+        return entry;
+    }
+
+    if(!exec.isNull() && !iconPath.isNull()) {
+
+        // The file name of the program, the window class is usually derived from it
+        QString executable;
+        if(startupWMClass.isEmpty()) {
+            QStringList tokens = tokenizeExec(exec);
+            int index = programIndex(tokens);
+            if(index < tokens.size()) {
+                // Windows are matched by their lowercase class, e.g. VirtualBox
+                executable = tokens[index].mid(tokens[index].lastIndexOf('/') + 1).toLower();
+            }
+        } else {
+            executable = startupWMClass.toLower();
+        }
+
+        if(!iconPath.contains("/")) {
+            iconName = iconPath;
+            iconPath = iconTheme.lookup(iconPath);
+            if(iconPath.isNull()) {
+                iconPath = iconTheme.fallbackIconPath();
+            }
+        }
+
+        if(!executable.isEmpty() && !iconPath.isEmpty()) {
+            entry.visible = true;
+            entry.key = executable;
+            entry.iconName = iconName;
+            entry.iconPath = iconPath;
+            entry.nameTokens = nameTokens;
+
+            // Folded once here so that matching does not need to
+            QStringList terms;
+            for(const QString &term : {name.value, genericName.value}) {
+                if(!term.isEmpty()) {
+                    terms << FoldedText::fold(term);
+                }
+            }
+            for(const QString &keyword : keywords.value.split(';', QString::SkipEmptyParts)) {
+                terms << FoldedText::fold(keyword.trimmed());
+            }
+            entry.searchText = terms.join('\n');
+
+            for(const QString &command : commands) {
+                QString executablePath = resolveExecutable(command);
+                if(!executablePath.isEmpty() && !entry.executablePaths.contains(executablePath)) {
+                    entry.executablePaths << executablePath;
+                }
+            }
+        }
+    }
+
+    return entry;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::DesktopIndex::apply(IndexUpdate &&update) {
+    for(const QString &path : update.removed) {
+        const QString prefix = path + '/';
+        for(auto it = entries.begin(); it != entries.end();) {
+            if(it.key() == path || it.key().startsWith(prefix)) {
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for(DesktopEntry &entry : update.entries) {
+        QString path = entry.path;
+        entries.insert(path, std::move(entry));
+    }
+}
+
+
+
+/** ***************************************************************************/
+QHash<QString, qint64> XWindowSwitcher::DesktopIndex::modificationTimes() const {
+    QHash<QString, qint64> modificationTimes;
+    modificationTimes.reserve(entries.size());
+    for(const DesktopEntry &entry : entries) {
+        modificationTimes.insert(entry.path, entry.modified);
+    }
+    return modificationTimes;
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::DesktopIndex::load(const QString &path, const QStringList &roots, const QStringList &locales) {
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_5);
+
+    quint32 magic;
+    quint32 version;
+    QStringList cachedRoots;
+    QStringList cachedLocales;
+    stream >> magic >> version;
+    if(magic != CACHE_MAGIC || version != CACHE_VERSION) {
+        return false;
+    }
+    stream >> cachedRoots >> cachedLocales;
+    if(cachedRoots != roots || cachedLocales != locales) {
+        return false;
+    }
+
+    quint32 count;
+    stream >> count;
+    QMap<QString, DesktopEntry> loaded;
+    for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        DesktopEntry entry;
+        qint32 priority;
+        stream >> entry.id >> entry.path >> priority >> entry.visible >> entry.key >> entry.iconName >> entry.iconPath
+               >> entry.nameTokens >> entry.searchText >> entry.executablePaths >> entry.modified;
+        entry.priority = priority;
+        loaded.insert(entry.path, entry);
+    }
+
+    if(stream.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    entries = loaded;
+    return true;
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::DesktopIndex::save(const QString &path, const QStringList &roots, const QStringList &locales) const {
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_5);
+    stream << quint32(CACHE_MAGIC) << quint32(CACHE_VERSION) << roots << locales << quint32(entries.size());
+    for(const DesktopEntry &entry : entries) {
+        stream << entry.id << entry.path << qint32(entry.priority) << entry.visible << entry.key << entry.iconName << entry.iconPath
+               << entry.nameTokens << entry.searchText << entry.executablePaths << entry.modified;
+    }
+
+    return file.commit();
+}
+
+
+
+/** ***************************************************************************/
+QHash<QString, QString> XWindowSwitcher::DesktopIndex::themedIcons(const QStringList &themeRoots, const QString &fallbackIconPath) const {
+    QHash<QString, QString> themedIcons;
+    for(const DesktopEntry &entry : entries) {
+        if(!entry.visible || entry.iconName.isEmpty()) {
+            continue;
+        }
+
+        // Unresolved icons may resolve now
+        bool affected = themeRoots.isEmpty() || entry.iconPath == fallbackIconPath;
+        for(int i = 0; !affected && i < themeRoots.size(); i++) {
+            affected = entry.iconPath.startsWith(themeRoots[i] + '/');
+        }
+        if(affected) {
+            themedIcons.insert(entry.path, entry.iconName);
+        }
+    }
+    return themedIcons;
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::DesktopIndex::updateIconPaths(const QHash<QString, QString> &iconPaths) {
+    bool changed = false;
+    for(auto it = iconPaths.begin(); it != iconPaths.end(); ++it) {
+        auto entry = entries.find(it.key());
+        if(entry != entries.end() && entry->iconPath != it.value()) {
+            entry->iconPath = it.value();
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+
+
+/** ***************************************************************************/
+vector<const XWindowSwitcher::DesktopEntry *> XWindowSwitcher::DesktopIndex::effectiveEntries() const {
+    // Unique ids, the entry of the most important application dir wins
+    map<QString /*desktop file id*/, const DesktopEntry *> desktopFiles;
+    for(const DesktopEntry &entry : entries) {
+        auto it = desktopFiles.find(entry.id);
+        if(it == desktopFiles.end()) {
+            desktopFiles.emplace(entry.id, &entry);
+        } else if(entry.priority < it->second->priority) {
+            it->second = &entry;
+        }
+    }
+
+    // Hidden winners still shadowed the others
+    vector<const DesktopEntry *> effective;
+    effective.reserve(desktopFiles.size());
+    for(const auto &id_entry_pair : desktopFiles) {
+        if(id_entry_pair.second->visible) {
+            effective.push_back(id_entry_pair.second);
+        }
+    }
+    return effective;
+}
+
+
+
+/** ***************************************************************************/
+QMap<QString, QString> XWindowSwitcher::DesktopIndex::iconPaths() const {
+    QMap<QString, QString> retrievedIconPaths;
+    for(const DesktopEntry *effectiveEntry : effectiveEntries()) {
+        const DesktopEntry &entry = *effectiveEntry;
+        retrievedIconPaths.insert(entry.key, entry.iconPath);
+
+        for(const QString &nameToken : entry.nameTokens) {
+            if(!retrievedIconPaths.contains(nameToken)) {
+                retrievedIconPaths.insert(nameToken, entry.iconPath);
+            }
+        }
+    }
+
+    return retrievedIconPaths;
+}
+
+
+
+/** ***************************************************************************/
+QHash<QString, QString> XWindowSwitcher::DesktopIndex::executables() const {
+    QHash<QString, QString> executables;
+    QSet<QString> ambiguous;
+    for(const DesktopEntry *entry : effectiveEntries()) {
+        for(const QString &executablePath : entry->executablePaths) {
+            auto it = executables.find(executablePath);
+            if(it == executables.end()) {
+                executables.insert(executablePath, entry->key);
+            } else if(it.value() != entry->key) {
+                ambiguous.insert(executablePath);
+            }
+        }
+    }
+
+    // Programs shared by different applications identify none of them
+    for(const QString &executablePath : ambiguous) {
+        executables.remove(executablePath);
+    }
+    return executables;
+}
+
+
+
+/** ***************************************************************************/
+QHash<QString, QString> XWindowSwitcher::DesktopIndex::searchTexts() const {
+    QHash<QString, QString> texts;
+    for(const DesktopEntry *entry : effectiveEntries()) {
+        if(!entry->searchText.isEmpty()) {
+            QString &text = texts[entry->key];
+            text = text.isEmpty() ? entry->searchText : text + '\n' + entry->searchText;
+        }
+    }
+    return texts;
+}
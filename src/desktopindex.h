@@ -0,0 +1,111 @@
+#pragma once
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <vector>
+
+namespace XWindowSwitcher {
+
+    class IconTheme;
+
+    struct DesktopEntry {
+        QString id;
+        QString path;
+        int priority = 0;       // Index of the application dir, lower wins
+        bool visible = false;   // Hidden entries still shadow entries with the same id
+        QString key;            // Lowercase window class derived from StartupWMClass or Exec
+        QString iconName;       // Icon= value if it was looked up in the icon theme
+        QString iconPath;
+        QStringList nameTokens;
+        QString searchText;     // Folded Name, GenericName and Keywords for the current locale
+        QStringList executablePaths;    // Canonical paths of the Exec and TryExec programs
+        qint64 modified = 0;    // Modification time of the file in ms since epoch
+    };
+
+    /*
+     * Result of a background scan. Everything at or below the removed paths is
+     * dropped before the entries get inserted. Complete is set if all
+     * application dirs have been walked.
+     */
+    struct IndexUpdate {
+        bool complete = false;
+        qint64 scanTime = 0;    // ns spent walking the dirs
+        qint64 parseTime = 0;   // ns spent parsing the new and changed files
+        QStringList removed;
+        QList<DesktopEntry> entries;
+    };
+
+    class DesktopIndex {
+        public:
+
+            /*
+             * Scans the given paths below the application dirs. Directories are
+             * rescanned recursively, files are reparsed or dropped if they vanished.
+             * An empty path list walks all roots, only files whose modification time
+             * differs from the known one are parsed then. Roots resolving to the
+             * same directory are walked once. Icon names are resolved through the
+             * theme. Thread safe.
+             */
+            static IndexUpdate scan(const QStringList &roots, const QStringList &paths, const std::shared_ptr<const IconTheme> &iconTheme,
+                                    const QHash<QString, qint64> &known);
+
+            /*
+             * Splits an Exec value into its arguments, resolving the escapes and
+             * the quoting defined by the desktop entry spec. Field codes are kept.
+             */
+            static QStringList tokenizeExec(const QString &value);
+
+            /*
+             * The id is the path relative to the application dir with '/' turned
+             * into '-'. The modification time is the one the scan compares, in ms
+             * since epoch from the stat of the walk.
+             */
+            static DesktopEntry parse(const QString &path, const QString &id, int priority, qint64 modified,
+                                      const IconTheme &iconTheme, const QStringList &locales);
+
+            /*
+             * The locale suffixes to look for in order of preference as defined
+             * by the desktop entry spec, e.g. de_DE@euro, de_DE, de@euro, de.
+             */
+            static QStringList localeKeys();
+
+            void apply(IndexUpdate &&update);
+            QHash<QString /*path*/, qint64> modificationTimes() const;
+
+            /*
+             * Persistent cache. Loading fails if the cache was written for other
+             * application dirs or locales, since the entries would be wrong.
+             */
+            bool load(const QString &path, const QStringList &roots, const QStringList &locales);
+            bool save(const QString &path, const QStringList &roots, const QStringList &locales) const;
+
+            /*
+             * Visible entries with a theme icon that resolved below one of the
+             * theme roots or not at all. Empty roots select all of them.
+             */
+            QHash<QString /*path*/, QString /*icon name*/> themedIcons(const QStringList &themeRoots, const QString &fallbackIconPath) const;
+
+            // @return True if any icon path changed
+            bool updateIconPaths(const QHash<QString /*path*/, QString /*icon path*/> &iconPaths);
+
+            // Like the entries below, only the effective entry of each desktop file id counts
+            QMap<QString, QString> iconPaths() const;
+            QHash<QString, QString> searchTexts() const;
+            QHash<QString /*executable path*/, QString /*key*/> executables() const;
+            int size() const { return entries.size(); }
+
+        private:
+
+            /*
+             * The visible entries that are in effect, by id. An id is served by
+             * the entry of the most important application dir, an overriding
+             * entry that is hidden hides the id altogether.
+             */
+            std::vector<const DesktopEntry *> effectiveEntries() const;
+
+            QMap<QString /*path*/, DesktopEntry> entries;
+    };
+}
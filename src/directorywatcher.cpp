@@ -0,0 +1,191 @@
+#include <QDebug>
+#include <QDirIterator>
+#include <QFile>
+#include <QSocketNotifier>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "directorywatcher.h"
+
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+/** ***************************************************************************/
+XWindowSwitcher::DirectoryWatcher::DirectoryWatcher(QObject *parent) : QObject(parent), notifier_(nullptr) {
+    debounce_.setSingleShot(true);
+    debounce_.setInterval(250);
+    connect(&debounce_, &QTimer::timeout, this, &DirectoryWatcher::flush);
+
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(fd_ == -1) {
+        qWarning() << "Cannot initialize inotify";
+        return;
+    }
+
+    notifier_ = new QSocketNotifier(fd_, QSocketNotifier::Read, this);
+    connect(notifier_, &QSocketNotifier::activated, this, &DirectoryWatcher::readEvents);
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::DirectoryWatcher::~DirectoryWatcher() {
+    if(fd_ != -1) {
+        delete notifier_;
+        close(fd_);
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::DirectoryWatcher::setRoots(const QStringList &roots) {
+    if(fd_ == -1) {
+        return;
+    }
+
+    for(const QString &root : roots_) {
+        removeRecursive(root);
+    }
+
+    roots_.clear();
+    for(const QString &root : roots) {
+        if(QFile::exists(root)) {
+            roots_.append(root);
+            addRecursive(root);
+        }
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::DirectoryWatcher::addRecursive(const QString &path) {
+    if(descriptors_.contains(path)) {
+        return;
+    }
+
+    int wd = inotify_add_watch(fd_, QFile::encodeName(path).constData(), WATCH_MASK);
+    if(wd == -1) {
+        return;
+    }
+
+    // inotify keeps one watch per (st_dev, st_ino). A known descriptor means
+    // the directory is watched under another path already, e.g. reached
+    // through a symlink loop, descending again would never end.
+    if(watches_.contains(wd)) {
+        return;
+    }
+    watches_.insert(wd, path);
+    descriptors_.insert(path, wd);
+    if(!recursive_) {
+        return;
+    }
+
+    QDirIterator dit(path, QDir::Dirs | QDir::NoDotAndDotDot);
+    while(dit.hasNext()) {
+        addRecursive(dit.next());
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::DirectoryWatcher::removeRecursive(const QString &path) {
+    const QString prefix = path + '/';
+    for(auto it = descriptors_.begin(); it != descriptors_.end();) {
+        if(it.key() == path || it.key().startsWith(prefix)) {
+            inotify_rm_watch(fd_, it.value());
+            watches_.remove(it.value());
+            it = descriptors_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::DirectoryWatcher::readEvents() {
+    alignas(inotify_event) char buffer[16 * 1024];
+    ssize_t length;
+
+    while((length = read(fd_, buffer, sizeof(buffer))) > 0) {
+        for(char *ptr = buffer; ptr < buffer + length;) {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            if(event->mask & IN_Q_OVERFLOW) {
+                // Events got lost, the only safe thing to do is a full rescan
+                for(const QString &root : roots_) {
+                    pending_.insert(root);
+                }
+                continue;
+            }
+
+            auto it = watches_.find(event->wd);
+            if(it == watches_.end()) {
+                continue;
+            }
+            const QString directory = it.value();
+
+            if(event->mask & IN_IGNORED) {
+                watches_.erase(it);
+                descriptors_.remove(directory);
+                continue;
+            }
+
+            // Event on the watched directory itself
+            if(event->len == 0) {
+                pending_.insert(directory);
+                continue;
+            }
+
+            const QString path = directory + '/' + QFile::decodeName(event->name);
+            if(recursive_ && (event->mask & IN_ISDIR)) {
+                if(event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    // Files may have been created before the watch got added,
+                    // the consumer rescans the whole directory anyway
+                    addRecursive(path);
+                } else if(event->mask & IN_MOVED_FROM) {
+                    removeRecursive(path);
+                }
+            }
+            pending_.insert(path);
+        }
+    }
+
+    schedule();
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::DirectoryWatcher::schedule() {
+    if(pending_.isEmpty()) {
+        return;
+    }
+
+    if(!firstPending_.isValid()) {
+        firstPending_.start();
+    }
+
+    // Restart the window on every event, unless the burst already lasts too
+    // long. In that case let the running timer fire to bound the latency.
+    if(!debounce_.isActive() || firstPending_.elapsed() < maximumLatency_) {
+        debounce_.start();
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::DirectoryWatcher::flush() {
+    firstPending_.invalidate();
+    if(pending_.isEmpty()) {
+        return;
+    }
+
+    QStringList paths = pending_.values();
+    pending_.clear();
+    emit changed(paths);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+class QSocketNotifier;
+
+namespace XWindowSwitcher {
+
+    /*
+     * Recursive inotify based directory watcher.
+     * Subdirectories are watched as they get created and dropped as they get
+     * removed, unless recursion is turned off. Symlinked directories are
+     * followed, each directory is watched once. Events are collected in a debounce window, so that bursts (e.g. a
+     * package transaction touching hundreds of files) are reported as a single
+     * changed() signal carrying the set of affected paths.
+     */
+    class DirectoryWatcher final : public QObject {
+        Q_OBJECT
+
+        public:
+
+            explicit DirectoryWatcher(QObject *parent = nullptr);
+            ~DirectoryWatcher() override;
+
+            void setRoots(const QStringList &roots);
+            QStringList roots() const { return roots_; }
+
+            void setDebounceInterval(int msec) { debounce_.setInterval(msec); }
+            void setMaximumLatency(int msec) { maximumLatency_ = msec; }
+
+            // Only the roots themselves get watched if false, applies to the next setRoots
+            void setRecursive(bool recursive) { recursive_ = recursive; }
+
+        signals:
+
+            /*
+             * Emitted once per burst. Contains the changed files and directories.
+             * A directory in the list means its whole content has to be rescanned,
+             * which is also what is reported for the roots if the kernel queue
+             * overflowed.
+             */
+            void changed(const QStringList &paths);
+
+        private:
+
+            void addRecursive(const QString &path);
+            void removeRecursive(const QString &path);
+            void readEvents();
+            void schedule();
+            void flush();
+
+            int fd_;
+            QSocketNotifier *notifier_;
+            QStringList roots_;
+            QHash<int, QString> watches_;
+            QHash<QString, int> descriptors_;
+            QSet<QString> pending_;
+            QTimer debounce_;
+            QElapsedTimer firstPending_;
+            int maximumLatency_ = 2000;
+            bool recursive_ = true;
+    };
+}
@@ -0,0 +1,64 @@
+#include <QDebug>
+#include <QFile>
+#include <QRegularExpression>
+#include "displayconnection.h"
+#include "xerrorfilter.h"
+
+/** ***************************************************************************/
+XWindowSwitcher::DisplayConnection::DisplayConnection(const QString &name, const QString &thumbnailDirectory, const std::atomic<bool> *thumbnailsActive)
+    : name_(name), thumbnailDirectory_(thumbnailDirectory), display_(nullptr), thumbnailer_(windowModel_) {
+    QByteArray encodedName = QFile::encodeName(name);
+    const char *displayName = name.isNull() ? NULL : encodedName.constData();
+
+    display_ = XOpenDisplay(displayName);
+    if(display_ == NULL) {
+        qDebug() << "Cannot open display" << (name.isNull() ? qgetenv("DISPLAY") : encodedName);
+        return;
+    }
+    XErrorFilter::add(display_);
+
+    if(!windowModel_.open(name)) {
+        XErrorFilter::remove(display_);
+        XCloseDisplay(display_);
+        display_ = nullptr;
+        return;
+    }
+
+    // Switching works without them
+    if(!thumbnailDirectory.isNull()) {
+        thumbnailer_.open(name, thumbnailDirectory, thumbnailsActive);
+    }
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::DisplayConnection::~DisplayConnection() {
+    thumbnailer_.close();
+    windowModel_.close();
+    if(display_ != nullptr) {
+        XErrorFilter::remove(display_);
+        XCloseDisplay(display_);
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::DisplayConnection::activateWindow(Window window) const {
+    if(display_ != nullptr) {
+        WindowModel::activateWindow(display_, window);
+    }
+}
+
+
+
+/** ***************************************************************************/
+QStringList XWindowSwitcher::DisplayConnection::parseNames(const QString &names) {
+    QStringList parsed = names.split(QRegularExpression("[,\\s]+"), QString::SkipEmptyParts);
+    parsed.removeDuplicates();
+    if(parsed.isEmpty()) {
+        parsed << QString();
+    }
+    return parsed;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <memory>
+#include "thumbnailer.h"
+#include "windowmodel.h"
+
+namespace XWindowSwitcher {
+
+    /*
+     * One configured X display and screen, e.g. ":0.1" or a nested ":2". Has
+     * a connection for the requests made on behalf of the user, like window
+     * activation, and a window model with an event connection of its own.
+     * Optionally a thumbnailer with a third connection follows the windows.
+     */
+    class DisplayConnection {
+        public:
+
+            /*
+             * A null name connects to $DISPLAY, a null directory disables
+             * thumbnails. They are only captured while the flag is set, see
+             * Thumbnailer.
+             */
+            explicit DisplayConnection(const QString &name, const QString &thumbnailDirectory = QString(),
+                                       const std::atomic<bool> *thumbnailsActive = nullptr);
+            ~DisplayConnection();
+
+            DisplayConnection(const DisplayConnection &) = delete;
+            DisplayConnection &operator=(const DisplayConnection &) = delete;
+
+            bool isOpen() const { return display_ != nullptr; }
+            const QString &name() const { return name_; }
+
+            const WindowModel &windowModel() const { return windowModel_; }
+
+            // Empty if thumbnails are disabled or not supported by the server
+            std::shared_ptr<const ThumbnailSnapshot> thumbnails() const { return thumbnailer_.snapshot(); }
+            const QString &thumbnailDirectory() const { return thumbnailDirectory_; }
+
+            // Call after changing the flag passed on construction
+            void wakeThumbnailer() const { thumbnailer_.wake(); }
+
+            // Call from the main thread only, the connection is not shared
+            void activateWindow(Window window) const;
+
+            /*
+             * Parses the configured display list, entries are separated by
+             * commas or whitespace. An empty list means $DISPLAY.
+             */
+            static QStringList parseNames(const QString &names);
+
+        private:
+
+            QString name_;
+            QString thumbnailDirectory_;
+            Display *display_;
+            WindowModel windowModel_;
+            Thumbnailer thumbnailer_;   // After the model it follows
+    };
+}
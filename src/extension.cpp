@@ -1,13 +1,38 @@
 #include <QDebug>
 #include <QPointer>
-#include <QFileSystemWatcher>
+#include <QCheckBox>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QFutureWatcher>
+#include <QIcon>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLineEdit>
+#include <QSet>
+#include <QSettings>
+#include <QSpinBox>
+#include <QStandardPaths>
+#include <QTimer>
 #include <QtConcurrent>
+#include <algorithm>
+#include <atomic>
 #include <stdexcept>
-#include "albert/util/standarditem.h"
-#include "xdg/iconlookup.h"
 #include "configwidget.h"
+#include "desktopindex.h"
+#include "displayconnection.h"
+#include "directorywatcher.h"
 #include "extension.h"
+#include "iconcache.h"
+#include "icontheme.h"
+#include "latencyhistogram.h"
+#include "matcher.h"
+#include "querymemo.h"
+#include "statsserver.h"
+#include "windowitems.h"
+#include "windowmodel.h"
+#include "windowsearch.h"
 
 Q_DECLARE_LOGGING_CATEGORY(qlc)
 Q_LOGGING_CATEGORY(qlc, "apps")
@@ -19,209 +44,571 @@ Q_LOGGING_CATEGORY(qlc, "apps")
 using namespace Core;
 using namespace std;
 
-#define MAX_PROPERTY_VALUE_LEN 4096
 #define FALLBACK_ICON "preferences-system"
+#define IDLE_INITIALIZATION_DELAY 15000
+#define REALTIME_BATCH_SIZE 4
+
+namespace {
+    const char *CFG_DEFERRED = "deferredStartup";
+    const bool DEF_DEFERRED = true;
+    const char *CFG_DISPLAYS = "displays";
+    const char *CFG_TRIGGER = "trigger";
+    const char *CFG_THUMBNAILS = "thumbnails";
+    const bool DEF_THUMBNAILS = false;
+    const char *CFG_STATS_SOCKET = "statsSocket";
+    const bool DEF_STATS_SOCKET = false;
+    const char *STATS_SOCKET_NAME = "albert-xwindowswitcher.sock";
+    const char *THUMBNAIL_DIRECTORY_NAME = "albert-xwindowswitcher-thumbnails";
+
+    // Records the lifetime of the instance, if given a histogram
+    struct LatencyRecorder {
+        XWindowSwitcher::LatencyHistogram *histogram;
+        QElapsedTimer timer;
+
+        explicit LatencyRecorder(XWindowSwitcher::LatencyHistogram *histogram) : histogram(histogram) {
+            if(histogram) {
+                timer.start();
+            }
+        }
+        ~LatencyRecorder() {
+            if(histogram) {
+                histogram->record(timer.nsecsElapsed());
+            }
+        }
+    };
+}
+
+namespace XWindowSwitcher {
+
+    /*
+     * Result of a background icon theme reload. The icon paths are the new
+     * ones of the desktop entries that were affected by the change.
+     */
+    struct ThemeUpdate {
+        shared_ptr<const IconTheme> theme;
+        QStringList changedRoots;   // Empty if everything has to be re-resolved
+        QHash<QString /*path*/, QString /*icon path*/> iconPaths;
+    };
+
+    /*
+     * Result of the startup worker. The connections and the cached index
+     * snapshot are published by the worker already, for the first queries.
+     */
+    struct Startup {
+        QStringList displayNames;   // The settings the displays were opened with
+        bool thumbnails = false;
+        DesktopIndex index;
+        bool cached = false;
+        shared_ptr<const IconTheme> theme;
+        qint64 displaysTime = 0;    // ns
+        qint64 cacheTime = 0;       // ns
+        qint64 themeTime = 0;       // ns
+    };
+
+    typedef vector<shared_ptr<const DisplayConnection>> ConnectionList;
+
+    // Everything a query needs, the snapshots are parallel to the connections
+    struct QueryContext : SearchContext {
+        Query *query;
+        shared_ptr<const ConnectionList> connections;
+        vector<shared_ptr<const ThumbnailSnapshot>> thumbnails;
+    };
+}
 
 class XWindowSwitcher::Private {
     public:
         QPointer<ConfigWidget> widget;
-        Display *display;
-        QMap<QString, QString> iconPaths;
-        QMap<QString, QString> index;
-        QString fallbackIconPath;
-
-        QFileSystemWatcher watcher;
-        QFutureWatcher<QMap<QString, QString>> futureWatcher;
-        bool rerun = false;
+        bool initialized = false;
+        bool ready = false;     // Startup finished, the displays may be reopened
+        QStringList displayNames;
+        shared_ptr<const QString> trigger;  // Empty unless the triggered realtime mode is enabled, use atomic_load/atomic_store
+        bool thumbnails = false;
+        QString thumbnailPath;
+        atomic<bool> sessionActive{false};  // Thumbnails are only captured during sessions
+        atomic<int> thumbnailers{0};   // Every thumbnailer gets a directory of its own
+        shared_ptr<const ConnectionList> connections;   // Use atomic_load/atomic_store
+        QString cachePath;
+        shared_ptr<const IndexSnapshot> indexSnapshot;  // Use atomic_load/atomic_store
+        WindowSearch search;
+        atomic<quint64> iconGeneration{0};  // From WindowModel::nextGeneration, bumped when cached icons get dropped
+        QueryMemo queryMemo;
+        shared_ptr<const SessionPrefetch> prefetch;     // Use atomic_load/atomic_store
+        QFuture<void> prefetchFuture;
+        atomic<bool> prefetchCancelled{false};
+        shared_ptr<const Matcher> matcher;  // Use atomic_load/atomic_store
+
+        QFutureWatcher<Startup> startupWatcher;
+        QElapsedTimer startupTimer;
+
+        DesktopIndex index;
+        DirectoryWatcher watcher;
+        QFutureWatcher<IndexUpdate> futureWatcher;
+        QSet<QString> pendingPaths;
+        bool pendingFullScan = false;
+        QElapsedTimer indexTimer;
 
-        void startIndexing();
+        /*
+         * All icons, of the index and of the windows, are resolved through an
+         * immutable IconTheme that gets replaced when the theme changes. The
+         * search holds the one the queries use, null until loaded.
+         * XDG::IconLookup caches its results forever and without a lock, it
+         * must not be used by the worker threads.
+         */
+        shared_ptr<const IconTheme> watchedTheme;
+        shared_ptr<const IconTheme> indexedTheme;   // The one the running scan resolves with
+        DirectoryWatcher themeWatcher;
+        QFutureWatcher<ThemeUpdate> themeFutureWatcher;
+        QSet<QString> pendingThemePaths;
+        bool pendingThemeReload = false;
+
+        // Only collected while the stats socket is open
+        atomic<bool> collectStats{false};
+        LatencyHistogram queryLatency;
+        atomic<quint64> memoizedQueries{0};
+        atomic<int> indexSize{0};
+        atomic<qint64> lastReindex{0};          // ms since epoch
+        atomic<qint64> lastReindexDuration{0};  // ms
+        atomic<qint64> lastScanTime{0};         // ns
+        atomic<qint64> lastParseTime{0};        // ns
+        atomic<qint64> startupDuration{0};      // ms
+        StatsServer statsServer;
+
+        void initialize();
+        void finishInitialization();
+        void openDisplays(const QStringList &names, bool withThumbnails);
+        void setSessionActive(bool active);
+        void startIndexing(const QStringList &paths = QStringList());
         void finishIndexing();
-        QMap<QString, QString> indexApplications() const;
+        void startThemeReload(const QStringList &paths);
+        void finishThemeReload();
+        void startPendingThemeReload();
+        void publishSnapshot();
+        void rebuild();
+        void setStatsSocket(bool enabled);
+        QByteArray statsDocument();
+        void compileMatcher(const QSettings &settings);
+        void startPrefetch();
+        void prefetchSession();
+        void cancelPrefetch();
+        QString thumbnailOrIconPath(const QueryContext &context, const Hit &hit);
+        shared_ptr<Item> makeItem(const QueryContext &context, const Hit &hit);
+        shared_ptr<Item> makeGroupItem(const QueryContext &context, const HitGroup &group);
 };
 
-void XWindowSwitcher::Private::startIndexing() {
-    // Never run concurrent
-    if(futureWatcher.future().isRunning()) {
-        rerun = true;
+void XWindowSwitcher::Private::initialize() {
+    if(initialized) {
         return;
     }
+    initialized = true;
+    startupTimer.start();
 
-    // Run finishIndexing when the indexing thread finished
-    futureWatcher.disconnect();
-    QObject::connect(&futureWatcher, &QFutureWatcher<QMap<QString, QString>>::finished,
-        std::bind(&Private::finishIndexing, this));
-
-    // Run the indexer thread
-    futureWatcher.setFuture(QtConcurrent::run(this, &Private::indexApplications));
+    /*
+     * Everything that blocks runs on a worker: connecting to the displays,
+     * reading the index cache and loading the icon theme. Nothing waits for
+     * it, queries meanwhile get what has been published so far, no windows
+     * before the displays are open and no desktop entries before the cache
+     * is read.
+     */
+    QStringList names = displayNames;
+    bool withThumbnails = thumbnails;
+    QString themeName = QIcon::themeName();
+    QStringList xdgAppDirs = QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation);
+    QObject::connect(&startupWatcher, &QFutureWatcher<Startup>::finished,
+        std::bind(&Private::finishInitialization, this));
+    startupWatcher.setFuture(QtConcurrent::run([this, names, withThumbnails, themeName, xdgAppDirs]() {
+        Startup startup;
+        startup.displayNames = names;
+        startup.thumbnails = withThumbnails;
+        QElapsedTimer timer;
+        timer.start();
+
+        // Window ids of an earlier run mean nothing now
+        QDir(thumbnailPath).removeRecursively();
+        openDisplays(names, withThumbnails);
+        startup.displaysTime = timer.nsecsElapsed();
+
+        // Serve the cached index right away, the scan then only parses changed files
+        startup.cached = startup.index.load(cachePath, xdgAppDirs, DesktopIndex::localeKeys());
+        if(startup.cached) {
+            atomic_store(&indexSnapshot, shared_ptr<const IndexSnapshot>(make_shared<IndexSnapshot>(startup.index)));
+            indexSize = startup.index.size();
+        }
+        startup.cacheTime = timer.nsecsElapsed() - startup.displaysTime;
+
+        // Scanning resolves icons, it waits for the theme
+        startup.theme = make_shared<IconTheme>(themeName, FALLBACK_ICON);
+        search.setIconTheme(startup.theme);
+        startup.themeTime = timer.nsecsElapsed() - startup.displaysTime - startup.cacheTime;
+        return startup;
+    }));
 }
 
-void XWindowSwitcher::Private::finishIndexing() {
-    // Get the thread results
-    index = futureWatcher.future().result();
+void XWindowSwitcher::Private::finishInitialization() {
+    Startup startup = startupWatcher.future().result();
+    ready = true;
 
-    // Rebuild
-    iconPaths.clear();
-    for(auto key : index.keys()) {
-        iconPaths.insert(key, index.value(key));
+    // The settings may have changed meanwhile
+    if(startup.displayNames != displayNames || startup.thumbnails != thumbnails) {
+        cancelPrefetch();
+        openDisplays(displayNames, thumbnails);
+    }
+    // The index and the theme do not depend on the displays, which can be reconfigured later
+    if(atomic_load(&connections)->empty()) {
+        WARN << "No display could be opened";
     }
 
-    // Finally update the watches (maybe folders changed)
-    if (!watcher.directories().isEmpty()) {
-        watcher.removePaths(watcher.directories());
-    } 
-    QStringList xdgAppDirs = QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation);
-    for(const QString &path : xdgAppDirs) {
-        if(QFile::exists(path)) {
-            watcher.addPath(path);
-            QDirIterator dit(path, QDir::Dirs|QDir::NoDotAndDotDot);
-            while (dit.hasNext()) {
-                watcher.addPath(dit.next());
+    index = std::move(startup.index);
+    watchedTheme = startup.theme;
+    themeWatcher.setRoots(watchedTheme->roots());
+    startIndexing();
+
+    // The cache may have been resolved with another theme, which is cheap to rule out
+    if(startup.cached || watchedTheme->name() != QIcon::themeName()) {
+        pendingThemeReload = true;
+    }
+    startPendingThemeReload();
+
+    // A session opened during startup had nothing to prefetch yet
+    if(sessionActive) {
+        startPrefetch();
+    }
+
+    startupDuration = startupTimer.elapsed();
+    INFO << QString("Initialized in %1 ms: displays %2 ms, index cache %3 ms, icon theme %4 ms, %5 cached desktop entries")
+            .arg(startupDuration.load()).arg(startup.displaysTime / 1e6, 0, 'f', 1).arg(startup.cacheTime / 1e6, 0, 'f', 1)
+            .arg(startup.themeTime / 1e6, 0, 'f', 1).arg(index.size());
+}
+
+void XWindowSwitcher::Private::publishSnapshot() {
+    atomic_store(&indexSnapshot, shared_ptr<const IndexSnapshot>(make_shared<IndexSnapshot>(index)));
+    indexSize = index.size();
+}
+
+void XWindowSwitcher::Private::openDisplays(const QStringList &names, bool withThumbnails) {
+    shared_ptr<const ConnectionList> previous = atomic_load(&connections);
+
+    // Keep the connections that are still wanted, open the others
+    auto opened = make_shared<ConnectionList>();
+    for(const QString &name : names) {
+        shared_ptr<const DisplayConnection> connection;
+        if(previous) {
+            for(const shared_ptr<const DisplayConnection> &candidate : *previous) {
+                if(candidate->name() == name && candidate->thumbnailDirectory().isNull() != withThumbnails) {
+                    connection = candidate;
+                }
+            }
+        }
+        if(!connection) {
+            // Replaced connections may live on in results, they clean up their own directory
+            QString thumbnailDirectory;
+            if(withThumbnails) {
+                thumbnailDirectory = QString("%1/%2-%3").arg(thumbnailPath, name.isNull() ? QString("default") : QString(name).replace('/', '_'))
+                                                        .arg(++thumbnailers);
             }
+            connection = make_shared<DisplayConnection>(name, thumbnailDirectory, &sessionActive);
+        }
+        if(connection->isOpen()) {
+            opened->push_back(std::move(connection));
         }
     }
 
-    if (rerun) {
-        startIndexing();
-        rerun = false;
+    atomic_store(&connections, shared_ptr<const ConnectionList>(std::move(opened)));
+
+    // Generations do not reflect dropped displays, the resolver knows the displays by index
+    queryMemo.clear();
+    search.pidResolver().clear();
+}
+
+void XWindowSwitcher::Private::setSessionActive(bool active) {
+    // Connections opened meanwhile read the flag on their own
+    sessionActive = active;
+    shared_ptr<const ConnectionList> sources = atomic_load(&connections);
+    if(sources) {
+        for(const shared_ptr<const DisplayConnection> &connection : *sources) {
+            connection->wakeThumbnailer();
+        }
     }
 }
 
-QMap<QString, QString> XWindowSwitcher::Private::indexApplications() const {
-    QMap<QString, QString> retrievedIconPaths;
-    QStringList xdg_current_desktop = QString(getenv("XDG_CURRENT_DESKTOP")).split(':',QString::SkipEmptyParts);
-    QLocale loc;
-    QStringList xdgAppDirs = QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation);
+void XWindowSwitcher::Private::rebuild() {
+    publishSnapshot();
 
-    /*
-     * Create a list of desktop files to index (unique ids)
-     * To determine the ID of a desktop file, make its full path relative to
-     * the $XDG_DATA_DIRS component in which the desktop file is installed,
-     * remove the "applications/" prefix, and turn '/' into '-'.
-     */
+    // Classes may be covered by the index now
+    search.iconCache().clear();
+    search.pidResolver().clear();
+}
+
+void XWindowSwitcher::Private::compileMatcher(const QSettings &settings) {
+    atomic_store(&matcher, shared_ptr<const Matcher>(make_shared<Matcher>(settings)));
+}
+
+void XWindowSwitcher::Private::startPrefetch() {
+    cancelPrefetch();
+    prefetchCancelled = false;
+    prefetchFuture = QtConcurrent::run([this]() {
+        prefetchSession();
+    });
+}
+
+void XWindowSwitcher::Private::prefetchSession() {
+    shared_ptr<const ConnectionList> sources = atomic_load(&connections);
+    if(!sources) {
+        return;
+    }
+    shared_ptr<const IndexSnapshot> index = atomic_load(&indexSnapshot);
+    if(!index) {
+        index = make_shared<IndexSnapshot>();
+    }
 
-    map<QString /*desktop file id*/, QString /*path*/> desktopFiles;
-    for (const QString &dir : xdgAppDirs ) {
-        QDirIterator fIt(dir, QStringList("*.desktop"), QDir::Files,
-                         QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
-        while(!fIt.next().isEmpty()) {
-            QString desktopFileId = fIt.filePath().remove(QRegularExpression("^.*applications/")).replace("/", "-");
-            desktopFiles.emplace(desktopFileId, fIt.filePath());
+    SnapshotList windows;
+    for(const shared_ptr<const DisplayConnection> &connection : *sources) {
+        windows.push_back(connection->windowModel().snapshot());
+    }
+    shared_ptr<const SessionPrefetch> result = search.prefetch(windows, std::move(index), prefetchCancelled);
+    if(result) {
+        atomic_store(&prefetch, std::move(result));
+    }
+}
+
+void XWindowSwitcher::Private::cancelPrefetch() {
+    prefetchCancelled = true;
+    prefetchFuture.waitForFinished();
+    atomic_store(&prefetch, shared_ptr<const SessionPrefetch>());
+}
+
+void XWindowSwitcher::Private::startIndexing(const QStringList &paths) {
+    // The first scan starts once the theme is loaded and covers everything
+    if(!watchedTheme) {
+        return;
+    }
+
+    // Never run concurrent, collect the changes for the next run
+    if(futureWatcher.future().isRunning()) {
+        if(paths.isEmpty()) {
+            pendingFullScan = true;
+        }
+        for(const QString &path : paths) {
+            pendingPaths.insert(path);
         }
+        return;
     }
 
-    // Iterate over all desktop files
-    for (const auto &id_path_pair : desktopFiles) {
-        const QString &path = id_path_pair.second;
+    // Run finishIndexing when the indexing thread finished
+    futureWatcher.disconnect();
+    QObject::connect(&futureWatcher, &QFutureWatcher<IndexUpdate>::finished,
+        std::bind(&Private::finishIndexing, this));
 
-        QString executable;
-        QString iconPath;
-        QString startupWMClass;
-        QStringList nameTokens;
-        bool desktopEntry = false;
-        bool applicationType = false;
-        bool noDisplay = false;
+    // Run the indexer thread
+    indexTimer.start();
+    indexedTheme = watchedTheme;
+    QStringList xdgAppDirs = QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation);
+    futureWatcher.setFuture(QtConcurrent::run(&DesktopIndex::scan, xdgAppDirs, paths, indexedTheme,
+                                              paths.isEmpty() ? index.modificationTimes() : QHash<QString, qint64>()));
+}
 
-        /*
-         * Get the data from the desktop file
-         */
+void XWindowSwitcher::Private::finishIndexing() {
+    // Get the thread results
+    IndexUpdate update = futureWatcher.future().result();
+    lastReindex = QDateTime::currentMSecsSinceEpoch();
+    lastReindexDuration = indexTimer.elapsed();
+    lastScanTime = update.scanTime;
+    lastParseTime = update.parseTime;
+    DEBG << QString("Indexed %1 desktop entries in %2 ms, %3 ms scanning, %4 ms parsing")
+            .arg(update.entries.size()).arg(lastReindexDuration.load())
+            .arg(update.scanTime / 1e6, 0, 'f', 1).arg(update.parseTime / 1e6, 0, 'f', 1);
+    bool complete = update.complete;
+    bool changed = !update.removed.isEmpty() || !update.entries.isEmpty();
+    index.apply(std::move(update));
+
+    if(changed) {
+        rebuild();
+        QStringList xdgAppDirs = QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation);
+        if(!index.save(cachePath, xdgAppDirs, DesktopIndex::localeKeys())) {
+            WARN << "Cannot write index cache" << cachePath;
+        }
+    }
 
-        // Read the file into a map
-        {
-            QFile file(path);
-            if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) 
-                continue;
-            QTextStream stream(&file);
-            for(QString line = stream.readLine(); !line.isNull(); line = stream.readLine()) {
-                line = line.trimmed();
-
-                if(!desktopEntry && line.contains("Desktop Entry")) {
-                    desktopEntry = true;
-                }
+    // A complete scan may have found new application dirs
+    if(complete) {
+        watcher.setRoots(QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation));
+    }
 
-                if(!applicationType && line.startsWith("Type=Application")) {
-                    applicationType = true;
-                }
+    // Entries resolved with a theme that got replaced during the scan
+    if(changed && indexedTheme != watchedTheme) {
+        pendingThemeReload = true;
+        startPendingThemeReload();
+    }
 
-                if(!noDisplay && line.startsWith("NoDisplay=true")) {
-                    noDisplay = true;
-                }
+    if(pendingFullScan) {
+        pendingFullScan = false;
+        pendingPaths.clear();
+        startIndexing();
+    } else if(!pendingPaths.isEmpty()) {
+        QStringList paths = pendingPaths.values();
+        pendingPaths.clear();
+        startIndexing(paths);
+    }
+}
+void XWindowSwitcher::Private::startThemeReload(const QStringList &paths) {
+    // Never run concurrent, collect the changes for the next run
+    if(themeFutureWatcher.future().isRunning()) {
+        if(paths.isEmpty()) {
+            pendingThemeReload = true;
+        }
+        for(const QString &path : paths) {
+            pendingThemePaths.insert(path);
+        }
+        return;
+    }
 
-                if(line.startsWith("Exec")) {
-                    int index = line.indexOf("=");
-                    if(index != -1) {
-                        executable = line.mid(index + 1);
-                    }
-
-                } else if(line.startsWith("Icon")) {
-                    int index = line.indexOf("=");
-                    if(index != -1) {
-                        iconPath = line.mid(index + 1);
-                    }
-
-                } else if(line.startsWith("StartupWMClass")) {
-                    int index = line.indexOf("=");
-                    if(index != -1) {
-                        startupWMClass = line.mid(index + 1);
-                    }
-                } else if(nameTokens.isEmpty() && line.startsWith("Name") && !line.contains('[') && !line.contains(']')) {
-                    int index = line.indexOf("=");
-                    if(index != -1) {
-                        nameTokens = QString(line.mid(index + 1)).toLower().split(" ");
-                    }
-                }
+    /*
+     * Only icons that resolved below a changed theme root are re-resolved.
+     * Installing icons rebuilds the icon-theme.cache of the root, the other
+     * top level entries are no sign of a change. A different theme or a
+     * changed index.theme (directories, inheritance) affects all of them.
+     * Absolute Icon= paths are never touched.
+     */
+    QString themeName = QIcon::themeName();
+    QStringList changedRoots;
+    bool everything = paths.isEmpty() || !watchedTheme || watchedTheme->name() != themeName;
+    for(const QString &path : paths) {
+        if(everything) {
+            break;
+        }
+        everything = path.endsWith("/index.theme");
+        for(const QString &root : watchedTheme->roots()) {
+            if((path == root || path == root + "/icon-theme.cache") && !changedRoots.contains(root)) {
+                changedRoots << root;
             }
-            file.close();
         }
+    }
+    if(everything) {
+        changedRoots.clear();
+    } else if(changedRoots.isEmpty()) {
+        return;
+    }
 
-        if(!desktopEntry || !applicationType || noDisplay) {
-            continue;
+    // Run finishThemeReload when the thread finished
+    themeFutureWatcher.disconnect();
+    QObject::connect(&themeFutureWatcher, &QFutureWatcher<ThemeUpdate>::finished,
+        std::bind(&Private::finishThemeReload, this));
+
+    QHash<QString, QString> iconNames = index.themedIcons(changedRoots, watchedTheme ? watchedTheme->fallbackIconPath() : QString());
+    themeFutureWatcher.setFuture(QtConcurrent::run([themeName, changedRoots, iconNames]() {
+        ThemeUpdate update{make_shared<IconTheme>(themeName, FALLBACK_ICON), changedRoots, QHash<QString, QString>()};
+        for(auto it = iconNames.begin(); it != iconNames.end(); ++it) {
+            QString iconPath = update.theme->lookup(it.value());
+            update.iconPaths.insert(it.key(), iconPath.isEmpty() ? update.theme->fallbackIconPath() : iconPath);
         }
+        return update;
+    }));
+}
 
-        if(!executable.isNull() && !iconPath.isNull()) {
+void XWindowSwitcher::Private::finishThemeReload() {
+    ThemeUpdate update = themeFutureWatcher.future().result();
 
-            if(startupWMClass.isEmpty()) {
+    if(!watchedTheme || update.theme->roots() != watchedTheme->roots()) {
+        themeWatcher.setRoots(update.theme->roots());
+    }
+    watchedTheme = update.theme;
+    search.setIconTheme(update.theme);
+
+    // The index might have been rescanned meanwhile, stale paths are skipped
+    if(index.updateIconPaths(update.iconPaths)) {
+        publishSnapshot();
+        QStringList xdgAppDirs = QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation);
+        if(!index.save(cachePath, xdgAppDirs, DesktopIndex::localeKeys())) {
+            WARN << "Cannot write index cache" << cachePath;
+        }
+    }
 
-                int lastSlashIndex = executable.lastIndexOf("/");
-                int index = executable.indexOf(' ', lastSlashIndex + 1);
-                if(index != -1) {
-                    executable = executable.mid(0, index);
-                }
+    if(update.changedRoots.isEmpty()) {
+        search.iconCache().clear();
+    } else {
+        search.iconCache().invalidate(update.changedRoots);
+    }
 
-                index = executable.lastIndexOf("/");
-                if(index != -1) {
-                    executable = executable.mid(index + 1);
-                }
+    // Memoized items hold the icon paths, the index snapshot may be unchanged
+    iconGeneration = WindowModel::nextGeneration();
 
-                index = executable.indexOf("\"");
-                while(index != -1) {
-                    executable = executable.replace(index, 2, ""); 
-                    index = executable.indexOf("\"");
-                }
+    DEBG << QString("Icon theme %1 reloaded, %2 desktop entry icons re-resolved")
+            .arg(update.theme->name()).arg(update.iconPaths.size());
 
-            } else {
-                executable = startupWMClass.toLower();
-            }
+    startPendingThemeReload();
+}
 
-            if(!iconPath.contains("/")) {
-                iconPath = XDG::IconLookup::iconPath(iconPath);
-                if(iconPath.isNull()) {
-                    iconPath = fallbackIconPath;
-                }
-            }
+void XWindowSwitcher::Private::startPendingThemeReload() {
+    if(pendingThemeReload) {
+        pendingThemeReload = false;
+        pendingThemePaths.clear();
+        startThemeReload(QStringList());
+    } else if(!pendingThemePaths.isEmpty()) {
+        QStringList paths = pendingThemePaths.values();
+        pendingThemePaths.clear();
+        startThemeReload(paths);
+    }
+}
+void XWindowSwitcher::Private::setStatsSocket(bool enabled) {
+    if(!enabled) {
+        collectStats = false;
+        statsServer.close();
+        return;
+    }
 
-            if(!executable.isEmpty() && !iconPath.isEmpty()) {
-                retrievedIconPaths.insert(executable, iconPath);
+    // Honors XDG_RUNTIME_DIR, Qt falls back to a private dir if it is unset
+    QString path = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation) + '/' + STATS_SOCKET_NAME;
+    if(statsServer.open(path, [this]() { return statsDocument(); })) {
+        INFO << "Serving statistics on" << path;
+    }
+    collectStats = statsServer.isOpen();
+}
 
-                for(QString nameToken : nameTokens) {
-                    if(!retrievedIconPaths.contains(nameToken)) {
-                        retrievedIconPaths.insert(nameToken, iconPath);
-                    }
-                }
-            }
+QByteArray XWindowSwitcher::Private::statsDocument() {
+    QJsonObject handleQuery = queryLatency.toJson();
+    handleQuery["memoized"] = double(memoizedQueries.load());
+
+    // Queries read the window model snapshot, the event thread does all of them
+    quint64 windowModelRoundTrips = 0;
+    int windows = 0;
+    QJsonArray displays;
+    shared_ptr<const ConnectionList> sources = atomic_load(&connections);
+    if(sources) {
+        for(const shared_ptr<const DisplayConnection> &connection : *sources) {
+            windowModelRoundTrips += connection->windowModel().roundTrips();
+            windows += static_cast<int>(connection->windowModel().snapshot()->windows.size());
+            displays.append(connection->name().isNull() ? QString::fromLocal8Bit(qgetenv("DISPLAY")) : connection->name());
         }
     }
 
-    return retrievedIconPaths;
+    QJsonObject roundTrips;
+    roundTrips["window_model"] = double(windowModelRoundTrips);
+
+    IconCache::Stats stats = search.iconCache().stats();
+    QJsonObject icons;
+    icons["entries"] = stats.entries;
+    icons["negative_entries"] = stats.negativeEntries;
+    icons["bytes"] = double(stats.bytes);
+    icons["hits"] = double(stats.hits);
+    icons["misses"] = double(stats.misses);
+    icons["hit_rate"] = stats.hitRate();
+
+    QJsonObject indexStats;
+    indexStats["size"] = indexSize.load();
+    qint64 reindexed = lastReindex.load();
+    indexStats["last_reindex"] = reindexed == 0 ? QJsonValue() : QJsonValue(QDateTime::fromMSecsSinceEpoch(reindexed).toString(Qt::ISODate));
+    indexStats["last_reindex_duration_ms"] = double(lastReindexDuration.load());
+    indexStats["last_scan_ms"] = lastScanTime.load() / 1e6;
+    indexStats["last_parse_ms"] = lastParseTime.load() / 1e6;
+
+    QJsonObject document;
+    document["handle_query"] = handleQuery;
+    document["x_round_trips"] = roundTrips;
+    document["icon_cache"] = icons;
+    document["index"] = indexStats;
+    document["displays"] = displays;
+    document["windows"] = windows;
+    document["startup_ms"] = double(startupDuration.load());
+    return QJsonDocument(document).toJson();
 }
 
 
@@ -229,27 +616,59 @@ QMap<QString, QString> XWindowSwitcher::Private::indexApplications() const {
 XWindowSwitcher::Extension::Extension() : Core::Extension("org.albert.extension.xwindowswitcher"), Core::QueryHandler(Core::Plugin::id()), d(new Private) {
     registerQueryHandler(this);
 
-    d->fallbackIconPath = XDG::IconLookup::iconPath(FALLBACK_ICON);
+    QElapsedTimer timer;
+    timer.start();
 
-    d->display = XOpenDisplay(NULL);
-    if(d->display == NULL) {
-        qDebug() << "Cannot open display";
+    d->compileMatcher(settings());
+    d->displayNames = DisplayConnection::parseNames(settings().value(CFG_DISPLAYS).toString());
+    atomic_store(&d->trigger, shared_ptr<const QString>(make_shared<QString>(settings().value(CFG_TRIGGER).toString())));
+    d->cachePath = cacheLocation().filePath("desktopindex");
+    d->thumbnails = settings().value(CFG_THUMBNAILS, DEF_THUMBNAILS).toBool() && Thumbnailer::isSupported();
 
-    } else {
+    // Usually a tmpfs, the thumbnails are rewritten on every capture and useless after a restart
+    d->thumbnailPath = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation) + '/' + THUMBNAIL_DIRECTORY_NAME;
+
+    // If the filesystem changed, trigger an incremental scan of the changed paths
+    connect(&d->watcher, &DirectoryWatcher::changed, this, [this](const QStringList &paths) {
+        d->startIndexing(paths);
+    });
 
-        // If the filesystem changed, trigger the scan
-        connect(&d->watcher, &QFileSystemWatcher::directoryChanged, std::bind(&Private::startIndexing, d.get()));
-        d->startIndexing();
+    /*
+     * If the icon theme changed on disk, re-resolve the icons that came from
+     * it. Only the theme roots are watched, a theme chain has thousands of
+     * icon directories and their watches would count against the same
+     * max_user_watches limit as the application dirs.
+     */
+    d->themeWatcher.setRecursive(false);
+    connect(&d->themeWatcher, &DirectoryWatcher::changed, this, [this](const QStringList &paths) {
+        d->startThemeReload(paths);
+    });
+
+    d->setStatsSocket(settings().value(CFG_STATS_SOCKET, DEF_STATS_SOCKET).toBool());
+
+    /*
+     * In deferred mode the display connection and the index are set up by the
+     * first session or once the launcher had some time to settle, so that the
+     * plugin does not compete with the others while Albert is starting.
+     */
+    if(settings().value(CFG_DEFERRED, DEF_DEFERRED).toBool()) {
+        QTimer::singleShot(IDLE_INITIALIZATION_DELAY, this, [this]() {
+            d->initialize();
+        });
+    } else {
+        d->initialize();
     }
+
+    INFO << QString("Loaded in %1 ms").arg(timer.elapsed());
 }
 
 
 
 /** ***************************************************************************/
 XWindowSwitcher::Extension::~Extension() {
-    if(d->display != NULL) {
-        XCloseDisplay(d->display);
-    }
+    d->startupWatcher.waitForFinished();
+    d->statsServer.close();
+    d->cancelPrefetch();
 }
 
 
@@ -258,22 +677,160 @@ XWindowSwitcher::Extension::~Extension() {
 QWidget *XWindowSwitcher::Extension::widget(QWidget *parent) {
     if(d->widget.isNull()) {
         d->widget = new ConfigWidget(parent);
+        Ui::ConfigWidget &ui = d->widget->ui;
+
+        ui.spinBox_minimumQueryLength->setValue(settings().value(Matcher::CFG_MIN_QUERY_LENGTH, Matcher::DEF_MIN_QUERY_LENGTH).toInt());
+        connect(ui.spinBox_minimumQueryLength, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, [this](int value) {
+            settings().setValue(Matcher::CFG_MIN_QUERY_LENGTH, value);
+            d->compileMatcher(settings());
+        });
+
+        ui.spinBox_maximumResults->setValue(settings().value(Matcher::CFG_MAX_RESULTS, Matcher::DEF_MAX_RESULTS).toInt());
+        connect(ui.spinBox_maximumResults, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, [this](int value) {
+            settings().setValue(Matcher::CFG_MAX_RESULTS, value);
+            d->compileMatcher(settings());
+        });
+
+        ui.spinBox_parallelThreshold->setValue(settings().value(Matcher::CFG_PARALLEL_THRESHOLD, Matcher::DEF_PARALLEL_THRESHOLD).toInt());
+        connect(ui.spinBox_parallelThreshold, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, [this](int value) {
+            settings().setValue(Matcher::CFG_PARALLEL_THRESHOLD, value);
+            d->compileMatcher(settings());
+        });
+
+        ui.spinBox_fuzzyDistance->setValue(settings().value(Matcher::CFG_FUZZY_DISTANCE, Matcher::DEF_FUZZY_DISTANCE).toInt());
+        connect(ui.spinBox_fuzzyDistance, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, [this](int value) {
+            settings().setValue(Matcher::CFG_FUZZY_DISTANCE, value);
+            d->compileMatcher(settings());
+        });
+
+        ui.lineEdit_excludedClasses->setText(settings().value(Matcher::CFG_EXCLUDED_CLASSES).toStringList().join(", "));
+        connect(ui.lineEdit_excludedClasses, &QLineEdit::editingFinished, this, [this]() {
+            QStringList excludedClasses = d->widget->ui.lineEdit_excludedClasses->text().split(',', QString::SkipEmptyParts);
+            for(QString &excludedClass : excludedClasses) {
+                excludedClass = excludedClass.trimmed();
+            }
+            settings().setValue(Matcher::CFG_EXCLUDED_CLASSES, excludedClasses);
+            d->compileMatcher(settings());
+        });
+
+        ui.checkBox_deferred->setChecked(settings().value(CFG_DEFERRED, DEF_DEFERRED).toBool());
+        connect(ui.checkBox_deferred, &QCheckBox::toggled, this, [this](bool checked) {
+            settings().setValue(CFG_DEFERRED, checked);
+        });
+
+        ui.checkBox_groupByClass->setChecked(settings().value(Matcher::CFG_GROUP_BY_CLASS, Matcher::DEF_GROUP_BY_CLASS).toBool());
+        connect(ui.checkBox_groupByClass, &QCheckBox::toggled, this, [this](bool checked) {
+            settings().setValue(Matcher::CFG_GROUP_BY_CLASS, checked);
+            d->compileMatcher(settings());
+        });
+
+        ui.checkBox_searchTitles->setChecked(settings().value(Matcher::CFG_SEARCH_TITLES, Matcher::DEF_SEARCH_TITLES).toBool());
+        connect(ui.checkBox_searchTitles, &QCheckBox::toggled, this, [this](bool checked) {
+            settings().setValue(Matcher::CFG_SEARCH_TITLES, checked);
+            d->compileMatcher(settings());
+        });
+
+        ui.checkBox_currentDesktopOnly->setChecked(settings().value(Matcher::CFG_CURRENT_DESKTOP_ONLY, Matcher::DEF_CURRENT_DESKTOP_ONLY).toBool());
+        connect(ui.checkBox_currentDesktopOnly, &QCheckBox::toggled, this, [this](bool checked) {
+            settings().setValue(Matcher::CFG_CURRENT_DESKTOP_ONLY, checked);
+            d->compileMatcher(settings());
+        });
+
+        ui.checkBox_excludeSkipTaskbar->setChecked(settings().value(Matcher::CFG_EXCLUDE_SKIP_TASKBAR, Matcher::DEF_EXCLUDE_SKIP_TASKBAR).toBool());
+        connect(ui.checkBox_excludeSkipTaskbar, &QCheckBox::toggled, this, [this](bool checked) {
+            settings().setValue(Matcher::CFG_EXCLUDE_SKIP_TASKBAR, checked);
+            d->compileMatcher(settings());
+        });
+
+        ui.lineEdit_displays->setText(settings().value(CFG_DISPLAYS).toString());
+        connect(ui.lineEdit_displays, &QLineEdit::editingFinished, this, [this]() {
+            QString displays = d->widget->ui.lineEdit_displays->text().trimmed();
+            settings().setValue(CFG_DISPLAYS, displays);
+            d->displayNames = DisplayConnection::parseNames(displays);
+            if(d->ready) {
+                d->cancelPrefetch();
+                d->openDisplays(d->displayNames, d->thumbnails);
+            }
+        });
+
+        ui.lineEdit_trigger->setText(*atomic_load(&d->trigger));
+        connect(ui.lineEdit_trigger, &QLineEdit::editingFinished, this, [this]() {
+            // Keep trailing whitespace, "w " is a sensible trigger
+            QString trigger = d->widget->ui.lineEdit_trigger->text();
+            atomic_store(&d->trigger, shared_ptr<const QString>(make_shared<QString>(trigger)));
+            settings().setValue(CFG_TRIGGER, trigger);
+        });
+
+        ui.checkBox_thumbnails->setChecked(d->thumbnails);
+        if(!Thumbnailer::isSupported()) {
+            ui.checkBox_thumbnails->setEnabled(false);
+            ui.checkBox_thumbnails->setToolTip("This build lacks the Composite, Damage and MIT-SHM libraries");
+        }
+        connect(ui.checkBox_thumbnails, &QCheckBox::toggled, this, [this](bool checked) {
+            settings().setValue(CFG_THUMBNAILS, checked);
+            d->thumbnails = checked;
+            if(d->ready) {
+                d->cancelPrefetch();
+                d->openDisplays(d->displayNames, d->thumbnails);
+            }
+        });
+
+        ui.checkBox_statsSocket->setChecked(settings().value(CFG_STATS_SOCKET, DEF_STATS_SOCKET).toBool());
+        connect(ui.checkBox_statsSocket, &QCheckBox::toggled, this, [this](bool checked) {
+            settings().setValue(CFG_STATS_SOCKET, checked);
+            d->setStatsSocket(checked);
+        });
     }
     return d->widget;
 }
 
 
 
+/** ***************************************************************************/
+QStringList XWindowSwitcher::Extension::triggers() const {
+    shared_ptr<const QString> trigger = atomic_load(&d->trigger);
+    return trigger->isEmpty() ? QStringList() : QStringList{*trigger};
+}
+
+
+
+/** ***************************************************************************/
+Core::QueryHandler::ExecutionType XWindowSwitcher::Extension::executionType() const {
+    // Realtime handlers only run if triggered
+    return atomic_load(&d->trigger)->isEmpty() ? ExecutionType::Batch : ExecutionType::Realtime;
+}
+
+
+
 /** ***************************************************************************/
 void XWindowSwitcher::Extension::setupSession() {
+    d->setSessionActive(true);
+    d->initialize();
 
+    // Theme switches do not touch the watched directories
+    if(d->watchedTheme && d->watchedTheme->name() != QIcon::themeName()) {
+        d->startThemeReload(QStringList());
+    }
+
+    // Spare the first keystroke the pid resolution, icon misses and case mapping
+    if(d->ready) {
+        d->startPrefetch();
+    }
 }
 
 
 
 /** ***************************************************************************/
 void XWindowSwitcher::Extension::teardownSession() {
-
+    // Nothing per session is held while the launcher is hidden
+    d->setSessionActive(false);
+    d->cancelPrefetch();
+    d->queryMemo.clear();
+
+    IconCache::Stats stats = d->search.iconCache().stats();
+    DEBG << QString("Icon cache: %1 entries (%2 negative), %3 bytes, %4 hits, %5 misses, %6% hit rate")
+            .arg(stats.entries).arg(stats.negativeEntries).arg(stats.bytes)
+            .arg(stats.hits).arg(stats.misses).arg(100 * stats.hitRate(), 0, 'f', 1);
 }
 
 
@@ -281,187 +838,123 @@ void XWindowSwitcher::Extension::teardownSession() {
 /** ***************************************************************************/
 void XWindowSwitcher::Extension::handleQuery(Core::Query *query) const {
 
-    if(d->display != NULL) {
+    // Null until the startup worker opened the displays
+    shared_ptr<const ConnectionList> connections = atomic_load(&d->connections);
+    if(connections && !connections->empty()) {
+
+        LatencyRecorder recorder(d->collectStats.load(memory_order_relaxed) ? &d->queryLatency : nullptr);
 
-        if(query->string().isEmpty() || query->string().length() <= 1) {
+        QueryContext context;
+        context.query = query;
+        context.matcher = atomic_load(&d->matcher);
+        context.index = atomic_load(&d->indexSnapshot);
+        if(!context.index) {
+            context.index = make_shared<IndexSnapshot>();
+        }
+        // The trigger alone lists all windows
+        if(!query->isTriggered() && !context.matcher->acceptsQuery(query->string())) {
             return;
         }
-
-        Window *clientList;
-        unsigned long clientListSize;
-
-        if((clientList = getClientList(d->display, &clientListSize)) == NULL) {
+        context.setQuery(query->string());
+        context.isValid = [query]() { return query->isValid(); };
+
+        // Generations are unique across models, the latest changes if any display or the icons changed
+        size_t windowCount = 0;
+        quint64 generation = d->iconGeneration.load();
+        for(const shared_ptr<const DisplayConnection> &connection : *connections) {
+            context.windows.push_back(connection->windowModel().snapshot());
+            context.thumbnails.push_back(connection->thumbnails());
+            windowCount += context.windows.back()->windows.size();
+            generation = qMax(generation, qMax(context.windows.back()->generation, context.thumbnails.back()->generation));
+        }
+        if(windowCount == 0) {
             qDebug() << "No windows found";
-            return; 
+            return;
         }
+        context.connections = std::move(connections);
 
-        clientListSize /= sizeof(Window);
-        for(long unsigned int i = 0; i < clientListSize; i++) {
-            char *title_utf8 = get_window_title(d->display, clientList[i]);
-            QString windowTitle(title_utf8);
+        // Unless the windows or the index changed since the session started
+        shared_ptr<const SessionPrefetch> prefetch = atomic_load(&d->prefetch);
+        if(prefetch && prefetch->windows == context.windows && prefetch->index == context.index) {
+            context.prefetch = std::move(prefetch);
+        }
 
-            if(title_utf8 != NULL) {
-                free(title_utf8);
-            } else {
-                windowTitle = "";
+        // Retyped or repeated queries on unchanged windows
+        MatchList matches;
+        if(d->queryMemo.lookup(context.foldedQuery, generation, context.matcher, context.index, &matches)) {
+            if(recorder.histogram) {
+                d->memoizedQueries.fetch_add(1, memory_order_relaxed);
             }
+            query->addMatches(matches.begin(), matches.end());
+            return;
+        }
 
-            XClassHint classHint;
-            XGetClassHint(d->display, clientList[i], &classHint);
-            QString applicationName(classHint.res_name);
-            if(applicationName.toLower().contains(query->string().toLower()) || windowTitle.toLower().contains(query->string().toLower())) {
-                auto item = make_shared<StandardItem>(applicationName);
-                item->setText("Switch Windows");
-                item->setSubtext(windowTitle);
-
-                QString iconPath;
-                if(d->iconPaths.contains(applicationName.toLower())) {
-                    iconPath = d->iconPaths[applicationName.toLower()];
-                } else {
-                    iconPath = XDG::IconLookup::iconPath(applicationName);
-
-                    if(iconPath.isEmpty()) {
-                        iconPath = XDG::IconLookup::iconPath(applicationName.toLower());
-                    }
-
-                    if(iconPath.isEmpty()) {
-                        d->iconPaths.insert(applicationName.toLower(), d->fallbackIconPath);
-                    } else {
-                        d->iconPaths.insert(applicationName.toLower(), iconPath);
-                    }
-                }
+        HitList hits = d->search.search(context);
 
-                item->setIconPath(iconPath);
-                item->addAction(make_shared<ActivateWindowAction>(applicationName, d->display, clientList[i]));
-                query->addMatch(std::move(item), 0);
+        /*
+         * Realtime results are shown unsorted as they come in. Hand them over
+         * best first in small batches while the icons of the rest get looked up.
+         * Only building the items is split that way, the first batch still
+         * comes after all windows have been matched and ranked.
+         */
+        size_t added = 0;
+        auto addReady = [&](bool all) {
+            if(all || (query->isTriggered() && matches.size() - added >= REALTIME_BATCH_SIZE)) {
+                query->addMatches(matches.begin() + static_cast<ptrdiff_t>(added), matches.end());
+                added = matches.size();
+            }
+        };
+
+        if(context.matcher->groupByClass()) {
+            vector<HitGroup> groups = WindowSearch::group(hits, *context.matcher);
+            matches.reserve(groups.size());
+            for(const HitGroup &group : groups) {
+                matches.emplace_back(d->makeGroupItem(context, group), group.front()->score);
+                addReady(false);
+            }
+        } else {
+            matches.reserve(hits.size());
+            for(const Hit &hit : hits) {
+                matches.emplace_back(d->makeItem(context, hit), hit.score);
+                addReady(false);
             }
         }
 
-        if(clientList != NULL) {
-            free(clientList);
+        // A cancelled query may have stopped matching early
+        if(query->isValid()) {
+            d->queryMemo.insert(context.foldedQuery, generation, context.matcher, context.index, matches);
         }
-    }
-}
 
-Window * XWindowSwitcher::Extension::getClientList(Display *display, unsigned long *size) const {
-    Window *clientList;
-    char netClientList[] = "_NET_CLIENT_LIST";
-
-    if ((clientList = (Window *)get_property(display, DefaultRootWindow(display), 
-                    XA_WINDOW, netClientList, size)) == NULL) {
-        return NULL;
+        addReady(true);
+        d->search.pidResolver().retain(context.windows);
     }
-
-    return clientList;
 }
 
-char * XWindowSwitcher::Extension::get_property(Display *disp, Window win,
-        Atom xa_prop_type, char *prop_name, unsigned long *size) const {
-    Atom xa_prop_name;
-    Atom xa_ret_type;
-    int ret_format;
-    unsigned long ret_nitems;
-    unsigned long ret_bytes_after;
-    unsigned long tmp_size;
-    unsigned char *ret_prop;
-    char *ret;
-    
-    xa_prop_name = XInternAtom(disp, prop_name, False);
-    
-    /* MAX_PROPERTY_VALUE_LEN / 4 explanation (XGetWindowProperty manpage):
-     *
-     * long_length = Specifies the length in 32-bit multiples of the
-     *               data to be retrieved.
-     */
-    if(XGetWindowProperty(disp, win, xa_prop_name, 0, MAX_PROPERTY_VALUE_LEN / 4, False,
-            xa_prop_type, &xa_ret_type, &ret_format,     
-            &ret_nitems, &ret_bytes_after, &ret_prop) != Success) {
-        return NULL;
-    }
-  
-    if(xa_ret_type != xa_prop_type) {
-        XFree(ret_prop);
-        return NULL;
-    }
-
-    // null terminate the result to make string handling easier 
-    tmp_size = (ret_format / 8) * ret_nitems;
-    // Correct 64 Architecture implementation of 32 bit data
-    if(ret_format==32) {
-        tmp_size *= sizeof(long) / 4;
-    }
-    ret = (char *)malloc(tmp_size + 1);
-
-    if(ret == NULL) {
-        return NULL;
-    }
 
-    memcpy(ret, ret_prop, tmp_size);
-    ret[tmp_size] = '\0';
 
-    if(size) {
-        *size = tmp_size;
-    }
-    
-    XFree(ret_prop);
-    return ret;
+/** ***************************************************************************/
+QString XWindowSwitcher::Private::thumbnailOrIconPath(const QueryContext &context, const Hit &hit) {
+    // Captured in the background, the query only looks them up
+    QString thumbnail = context.thumbnails[hit.source]->paths.value(hit.window->window);
+    return thumbnail.isNull() ? search.iconPath(*context.index, hit.key, hit.window->windowClass) : thumbnail;
 }
 
-char * XWindowSwitcher::Extension::get_window_title(Display *disp, Window win) const {
-    char *title;
-    char *net_wm_name;
-    char utf8[] = "UTF8_STRING";
-    char netWMName[] = "_NET_WM_NAME";
-  
-    net_wm_name = get_property(disp, win, XInternAtom(disp, utf8, False), netWMName, NULL);
 
-    if (net_wm_name) {
-        title = strdup(net_wm_name);
-        free(net_wm_name);
-        return title;
 
-    } else {
-        XTextProperty textProperty;
-        if(XGetWMName(disp, win, &textProperty)) {
-            char *converted = reinterpret_cast<char*>(textProperty.value);
-            title = strdup(converted);
-            return title;
-        } else {
-            return NULL;
-        }
-    }
+/** ***************************************************************************/
+shared_ptr<Item> XWindowSwitcher::Private::makeItem(const QueryContext &context, const Hit &hit) {
+    return makeWindowItem(hit, thumbnailOrIconPath(context, hit), (*context.connections)[hit.source]);
 }
 
-XWindowSwitcher::ActivateWindowAction::ActivateWindowAction(const QString &text, Display *display, Window window)
-    : StandardActionBase(text), display(display), window(window) {
 
-}
 
-void XWindowSwitcher::ActivateWindowAction::activate() const {
-    if(display != NULL) {
-        char netActiveWindow[] = "_NET_ACTIVE_WINDOW";
-        client_msg(netActiveWindow);
-        XMapRaised(display, window);
-        XSetInputFocus(display, window, RevertToNone, CurrentTime);
-        XSync(display, false);
+/** ***************************************************************************/
+shared_ptr<Item> XWindowSwitcher::Private::makeGroupItem(const QueryContext &context, const HitGroup &group) {
+    if(group.size() == 1) {
+        return makeItem(context, *group.front());
     }
-}
 
-void XWindowSwitcher::ActivateWindowAction::client_msg(char *msg) const {
-    XEvent event;
-    long mask = SubstructureRedirectMask | SubstructureNotifyMask;
-
-    event.xclient.type = ClientMessage;
-    event.xclient.serial = 0;
-    event.xclient.send_event = True;
-    event.xclient.message_type = XInternAtom(display, msg, False);
-    event.xclient.window = window;
-    event.xclient.format = 32;
-    event.xclient.data.l[0] = 0;
-    event.xclient.data.l[1] = 0;
-    event.xclient.data.l[2] = 0;
-    event.xclient.data.l[3] = 0;
-    event.xclient.data.l[4] = 0;
-
-    XSendEvent(display, DefaultRootWindow(display), False, mask, &event);
-}
\ No newline at end of file
+    // Best title: earliest title match, then the topmost window
+    const Hit *best = WindowSearch::representative(group);
+    return makeClassItem(*best, group.size(), thumbnailOrIconPath(context, *best), (*context.connections)[best->source]);
+}
@@ -4,7 +4,6 @@
 #include <memory>
 #include "albert/extension.h"
 #include "albert/queryhandler.h"
-#include "albert/util/standardactions.h"
 
 // X11 headers must be included before Qt headers in cpp file
 #include <X11/Xlib.h>
@@ -29,6 +28,8 @@ namespace XWindowSwitcher {
 
             QString name() const override { return "X Window Switcher"; }
             QWidget *widget(QWidget *parent = nullptr) override;
+            QStringList triggers() const override;
+            ExecutionType executionType() const override;
             void setupSession() override;
             void teardownSession() override;
             void handleQuery(Core::Query * query) const override;
@@ -36,20 +37,5 @@ namespace XWindowSwitcher {
         private:
 
             std::unique_ptr<Private> d;
-            Window * getClientList(Display *display, unsigned long *size) const;
-            char * get_property(Display *disp, Window win, Atom xa_prop_type, char *prop_name, unsigned long *size) const;
-            char * get_window_title(Display *disp, Window win) const;
-    };
-
-    struct ActivateWindowAction : public Core::StandardActionBase {
-        public:
-            ActivateWindowAction(const QString &text, Display *display, Window window);
-            void activate() const override;
-
-        private:
-            Display *display;
-            Window window;
-            
-            void client_msg(char *msg) const;
     };
 }
@@ -0,0 +1,80 @@
+#include "foldedtext.h"
+
+using namespace std;
+
+namespace {
+
+    // Offsets may be null if the caller does not need them
+    void foldInto(const QString &original, QString *folded, vector<int> *offsets) {
+        folded->reserve(original.size());
+        for(int i = 0; i < original.size();) {
+            ushort unit = original.at(i).unicode();
+
+            // ASCII neither decomposes nor has marks
+            if(unit < 0x80) {
+                folded->append(QChar(unit >= 'A' && unit <= 'Z' ? unit + ('a' - 'A') : unit));
+                if(offsets) {
+                    offsets->push_back(i);
+                }
+                i++;
+                continue;
+            }
+
+            int length = original.at(i).isHighSurrogate() && i + 1 < original.size() && original.at(i + 1).isLowSurrogate() ? 2 : 1;
+            QString decomposed = original.mid(i, length).normalized(QString::NormalizationForm_KD);
+            for(int j = 0; j < decomposed.size();) {
+                uint codePoint = decomposed.at(j).unicode();
+                int units = 1;
+                if(QChar::isHighSurrogate(codePoint) && j + 1 < decomposed.size() && decomposed.at(j + 1).isLowSurrogate()) {
+                    codePoint = QChar::surrogateToUcs4(decomposed.at(j), decomposed.at(j + 1));
+                    units = 2;
+                }
+
+                if(QChar::category(codePoint) != QChar::Mark_NonSpacing) {
+                    QString piece = decomposed.mid(j, units).toCaseFolded();
+                    folded->append(piece);
+                    if(offsets) {
+                        offsets->insert(offsets->end(), static_cast<size_t>(piece.size()), i);
+                    }
+                }
+                j += units;
+            }
+            i += length;
+        }
+    }
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::FoldedText::FoldedText(const QString &original) {
+    foldInto(original, &text_, &offsets_);
+
+    // Mostly ASCII, where every unit maps to itself
+    bool identity = offsets_.size() == static_cast<size_t>(original.size());
+    for(size_t i = 0; identity && i < offsets_.size(); i++) {
+        identity = offsets_[i] == static_cast<int>(i);
+    }
+    if(identity) {
+        vector<int>().swap(offsets_);
+    }
+}
+
+
+
+/** ***************************************************************************/
+int XWindowSwitcher::FoldedText::originalPosition(int position) const {
+    if(position < 0 || offsets_.empty()) {
+        return position;
+    }
+    return offsets_[static_cast<size_t>(position)];
+}
+
+
+
+/** ***************************************************************************/
+QString XWindowSwitcher::FoldedText::fold(const QString &original) {
+    QString folded;
+    foldInto(original, &folded, nullptr);
+    return folded;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <QString>
+#include <vector>
+
+namespace XWindowSwitcher {
+
+    /*
+     * Text folded for matching: compatibility decomposed (NFKD), combining
+     * marks stripped and case folded, so that "Écran" and "ｅｃｒａｎ" both
+     * become "ecran". Keeps where every folded code unit came from, so that
+     * positions found in the folded text can be mapped back for highlighting.
+     * Folding is expensive, do it once when the text changes.
+     */
+    class FoldedText {
+        public:
+
+            FoldedText() = default;
+            explicit FoldedText(const QString &original);
+
+            const QString &text() const { return text_; }
+
+            // Position in the original text of a position in the folded one, -1 stays -1
+            int originalPosition(int position) const;
+
+            // Folds without the position map, e.g. for queries
+            static QString fold(const QString &original);
+
+        private:
+
+            QString text_;
+            std::vector<int> offsets_;  // Original position per folded code unit, empty if they are the same
+    };
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include "fuzzypattern.h"
+
+using namespace std;
+
+/** ***************************************************************************/
+XWindowSwitcher::FuzzyPattern::FuzzyPattern(const QString &pattern, int maximumDistance) {
+    if(pattern.isEmpty() || pattern.size() > MAX_LENGTH || maximumDistance <= 0) {
+        return;
+    }
+
+    for(int i = 0; i < pattern.size(); i++) {
+        ushort unit = pattern.at(i).unicode();
+        quint64 bit = quint64(1) << i;
+        if(unit < ascii_.size()) {
+            ascii_[unit] |= bit;
+            continue;
+        }
+
+        auto it = lower_bound(others_.begin(), others_.end(), unit, [](const pair<ushort, quint64> &entry, ushort value) {
+            return entry.first < value;
+        });
+        if(it != others_.end() && it->first == unit) {
+            it->second |= bit;
+        } else {
+            others_.insert(it, make_pair(unit, bit));
+        }
+    }
+
+    length_ = pattern.size();
+    maximumDistance_ = maximumDistance;
+}
+
+
+
+/** ***************************************************************************/
+quint64 XWindowSwitcher::FuzzyPattern::mask(ushort unit) const {
+    if(unit < ascii_.size()) {
+        return ascii_[unit];
+    }
+
+    auto it = lower_bound(others_.begin(), others_.end(), unit, [](const pair<ushort, quint64> &entry, ushort value) {
+        return entry.first < value;
+    });
+    return it != others_.end() && it->first == unit ? it->second : 0;
+}
+
+
+
+/** ***************************************************************************/
+int XWindowSwitcher::FuzzyPattern::distance(const QString &text, int *end) const {
+    if(length_ == 0) {
+        return -1;
+    }
+
+    /*
+     * Columns of the dynamic programming matrix as vertical deltas, positive
+     * in pv, negative in mv. The first row stays zero, a match may start
+     * anywhere. The score tracks the last row, the distance of the whole
+     * pattern against the best substring ending at the current position.
+     */
+    const quint64 last = quint64(1) << (length_ - 1);
+    quint64 pv = ~quint64(0);
+    quint64 mv = 0;
+    int score = length_;
+    int best = length_;
+    int bestEnd = -1;
+
+    const QChar *data = text.constData();
+    for(int i = 0; i < text.size(); i++) {
+        quint64 eq = mask(data[i].unicode());
+        quint64 xv = eq | mv;
+        quint64 xh = (((eq & pv) + pv) ^ pv) | eq;
+        quint64 ph = mv | ~(xh | pv);
+        quint64 mh = pv & xh;
+
+        if(ph & last) {
+            score++;
+        } else if(mh & last) {
+            score--;
+        }
+
+        ph <<= 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+
+        if(score < best) {
+            best = score;
+            bestEnd = i + 1;
+            if(best == 0) {
+                break;
+            }
+        }
+    }
+
+    if(bestEnd == -1 || best > maximumDistance_) {
+        return -1;
+    }
+    if(end != nullptr) {
+        *end = bestEnd;
+    }
+    return best;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <QString>
+#include <array>
+#include <utility>
+#include <vector>
+
+namespace XWindowSwitcher {
+
+    /*
+     * Approximate substring search after Myers' bit-parallel algorithm. Finds
+     * the smallest edit distance between the pattern and any substring of a
+     * text in a single pass, a dozen word operations per character. Patterns
+     * are limited to one machine word of code units. Immutable, so it can be
+     * shared by the threads matching a query.
+     */
+    class FuzzyPattern {
+        public:
+
+            static const int MAX_LENGTH = 64;
+
+            FuzzyPattern() = default;
+
+            // Null if the pattern is empty, too long or no distance is allowed
+            FuzzyPattern(const QString &pattern, int maximumDistance);
+
+            bool isNull() const { return length_ == 0; }
+            int length() const { return length_; }
+
+            /*
+             * @param end Set to the position after the best match, if there is one
+             * @return The smallest distance, -1 if it exceeds the maximum
+             */
+            int distance(const QString &text, int *end = nullptr) const;
+
+        private:
+
+            quint64 mask(ushort unit) const;
+
+            std::array<quint64, 128> ascii_{};  // Bit i is set if the pattern has the unit at i
+            std::vector<std::pair<ushort, quint64>> others_;    // Sorted by unit
+            int length_ = 0;
+            int maximumDistance_ = 0;
+    };
+}
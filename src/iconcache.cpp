@@ -0,0 +1,115 @@
+#include "iconcache.h"
+
+/** ***************************************************************************/
+XWindowSwitcher::IconCache::IconCache(int capacity, qint64 negativeTtl) : capacity_(capacity), negativeTtl_(negativeTtl) {
+    clock_.start();
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::IconCache::lookup(const QString &key, QString *iconPath) {
+    QMutexLocker locker(&mutex_);
+
+    auto it = lookup_.find(key);
+    if(it == lookup_.end()) {
+        misses_++;
+        return false;
+    }
+
+    auto node = it.value();
+    if(node->iconPath.isEmpty() && node->expires <= clock_.elapsed()) {
+        remove(node);
+        misses_++;
+        return false;
+    }
+
+    // Move to the front, iterators stay valid
+    nodes_.splice(nodes_.begin(), nodes_, node);
+    *iconPath = node->iconPath;
+    hits_++;
+    return true;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::IconCache::insert(const QString &key, const QString &iconPath) {
+    QMutexLocker locker(&mutex_);
+
+    auto it = lookup_.find(key);
+    if(it != lookup_.end()) {
+        remove(it.value());
+    }
+
+    while(!nodes_.empty() && nodes_.size() >= static_cast<size_t>(capacity_)) {
+        remove(std::prev(nodes_.end()));
+    }
+
+    nodes_.push_front(Node{key, iconPath.isEmpty() ? QString() : iconPath, clock_.elapsed() + negativeTtl_});
+    lookup_.insert(key, nodes_.begin());
+    bytes_ += cost(nodes_.front());
+    if(iconPath.isEmpty()) {
+        negativeEntries_++;
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::IconCache::invalidate(const QStringList &directories) {
+    QMutexLocker locker(&mutex_);
+
+    for(auto it = nodes_.begin(); it != nodes_.end();) {
+        bool affected = it->iconPath.isEmpty();
+        for(int i = 0; !affected && i < directories.size(); i++) {
+            affected = it->iconPath.startsWith(directories[i] + '/');
+        }
+        if(affected) {
+            remove(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::IconCache::clear() {
+    QMutexLocker locker(&mutex_);
+    nodes_.clear();
+    lookup_.clear();
+    bytes_ = 0;
+    negativeEntries_ = 0;
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::IconCache::Stats XWindowSwitcher::IconCache::stats() const {
+    QMutexLocker locker(&mutex_);
+    return Stats{lookup_.size(), negativeEntries_, bytes_, hits_, misses_};
+}
+
+
+
+/** ***************************************************************************/
+qint64 XWindowSwitcher::IconCache::cost(const Node &node) {
+    // String payloads, the list node and a hash node holding a key copy reference
+    return (node.key.capacity() + node.iconPath.capacity()) * qint64(sizeof(QChar))
+        + qint64(sizeof(Node) + 2 * sizeof(void *))
+        + qint64(sizeof(QString) + sizeof(std::list<Node>::iterator) + 2 * sizeof(void *));
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::IconCache::remove(std::list<Node>::iterator it) {
+    bytes_ -= cost(*it);
+    if(it->iconPath.isEmpty()) {
+        negativeEntries_--;
+    }
+    lookup_.remove(it->key);
+    nodes_.erase(it);
+}
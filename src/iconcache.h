@@ -0,0 +1,73 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <iterator>
+#include <list>
+
+namespace XWindowSwitcher {
+
+    /*
+     * Size bounded cache of icon lookups for window classes that are not
+     * covered by the desktop index. The least recently used entry is evicted
+     * once the capacity is reached. Misses are cached as negative entries that
+     * expire, so icons installed later get picked up. Thread safe.
+     */
+    class IconCache {
+        public:
+
+            struct Stats {
+                int entries;
+                int negativeEntries;
+                qint64 bytes;
+                quint64 hits;
+                quint64 misses;
+                double hitRate() const { return hits + misses == 0 ? 0.0 : double(hits) / (hits + misses); }
+            };
+
+            explicit IconCache(int capacity = 512, qint64 negativeTtl = 300000);
+
+            /*
+             * @param iconPath Set to the cached path, null for a negative entry
+             * @return True on a hit, false if the key has to be looked up
+             */
+            bool lookup(const QString &key, QString *iconPath);
+
+            // A null or empty icon path inserts a negative entry
+            void insert(const QString &key, const QString &iconPath);
+
+            /*
+             * Drops the entries whose icon lives below one of the directories
+             * and all negative entries, since those icons may exist now.
+             */
+            void invalidate(const QStringList &directories);
+
+            void clear();
+            Stats stats() const;
+
+        private:
+
+            struct Node {
+                QString key;
+                QString iconPath;
+                qint64 expires;     // Only used by negative entries
+            };
+
+            static qint64 cost(const Node &node);
+            void remove(std::list<Node>::iterator it);
+
+            const int capacity_;
+            const qint64 negativeTtl_;
+            QElapsedTimer clock_;
+
+            mutable QMutex mutex_;
+            std::list<Node> nodes_;     // Most recently used first
+            QHash<QString, std::list<Node>::iterator> lookup_;
+            qint64 bytes_ = 0;
+            int negativeEntries_ = 0;
+            quint64 hits_ = 0;
+            quint64 misses_ = 0;
+    };
+}
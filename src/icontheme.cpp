@@ -0,0 +1,155 @@
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStandardPaths>
+#include <algorithm>
+#include "icontheme.h"
+
+namespace {
+
+    // In order of preference within a directory
+    const char *extensions[] = {".png", ".svg", ".xpm"};
+    const int extensionCount = static_cast<int>(sizeof(extensions) / sizeof(extensions[0]));
+
+    int extensionIndex(const QString &fileName, int *dot) {
+        *dot = fileName.lastIndexOf('.');
+        for(int i = 0; *dot != -1 && i < extensionCount; i++) {
+            if(fileName.midRef(*dot) == QLatin1String(extensions[i])) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    struct ThemeDirectory {
+        QString path;
+        int size;
+        bool scalable;
+    };
+}
+
+/** ***************************************************************************/
+XWindowSwitcher::IconTheme::IconTheme(const QString &name, const QString &fallbackIconName) : name_(name) {
+    QStringList searchPaths;
+    searchPaths << QDir::home().filePath(".icons");
+    searchPaths << QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, "icons", QStandardPaths::LocateDirectory);
+
+    // Breadth first through the inheritance chain, hicolor is the implicit last resort
+    QStringList themes = {name};
+    for(int i = 0; i < themes.size(); i++) {
+        const QString theme = themes[i];
+
+        // A theme may be spread over several base dirs, its first index.theme counts
+        QStringList themeRoots;
+        QString indexFile;
+        for(const QString &searchPath : searchPaths) {
+            const QString root = searchPath + '/' + theme;
+            if(theme.isEmpty() || !QFileInfo(root).isDir()) {
+                continue;
+            }
+            themeRoots << root;
+            if(indexFile.isNull() && QFile::exists(root + "/index.theme")) {
+                indexFile = root + "/index.theme";
+            }
+        }
+
+        if(!indexFile.isNull()) {
+            QSettings index(indexFile, QSettings::IniFormat);
+            index.beginGroup("Icon Theme");
+            const QStringList directories = index.value("Directories").toStringList();
+            const QStringList inherits = index.value("Inherits").toStringList();
+            index.endGroup();
+
+            // Scalable first, then the largest size. Stable, so ties keep the order of the index.
+            QList<ThemeDirectory> sorted;
+            for(const QString &directory : directories) {
+                index.beginGroup(directory);
+                sorted << ThemeDirectory{directory, index.value("Size").toInt(), index.value("Type").toString() == "Scalable"};
+                index.endGroup();
+            }
+            std::stable_sort(sorted.begin(), sorted.end(), [](const ThemeDirectory &lhs, const ThemeDirectory &rhs) {
+                if(lhs.scalable != rhs.scalable) {
+                    return lhs.scalable;
+                }
+                return lhs.size > rhs.size;
+            });
+
+            for(const QString &root : themeRoots) {
+                roots_ << root;
+            }
+            for(const ThemeDirectory &directory : sorted) {
+                for(const QString &root : themeRoots) {
+                    addDirectory(root + '/' + directory.path);
+                }
+            }
+            for(const QString &inherited : inherits) {
+                if(!themes.contains(inherited.trimmed())) {
+                    themes << inherited.trimmed();
+                }
+            }
+        }
+
+        if(i == themes.size() - 1 && !themes.contains("hicolor")) {
+            themes << "hicolor";
+        }
+    }
+
+    addDirectory("/usr/share/pixmaps");
+
+    if(!fallbackIconName.isNull()) {
+        fallbackIconPath_ = lookup(fallbackIconName);
+    }
+}
+
+
+
+/** ***************************************************************************/
+QString XWindowSwitcher::IconTheme::lookup(const QString &iconName) const {
+    auto it = icons_.find(iconName);
+
+    // Icon= values with an extension are not allowed but common
+    int dot;
+    if(it == icons_.end() && extensionIndex(iconName, &dot) != -1) {
+        it = icons_.find(iconName.left(dot));
+    }
+    if(it == icons_.end()) {
+        return QString();
+    }
+
+    const QString name = it.key();
+    return directories_[it.value() / extensionCount] + '/' + name + extensions[it.value() % extensionCount];
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::IconTheme::addDirectory(const QString &directory) {
+    // The first directory holding an icon wins, within a directory the first extension
+    const int directoryIndex = directories_.size();
+    bool used = false;
+    QDirIterator it(directory, QDir::Files);
+    while(it.hasNext()) {
+        it.next();
+        const QString fileName = it.fileName();
+        int dot;
+        int extension = extensionIndex(fileName, &dot);
+        if(extension == -1) {
+            continue;
+        }
+
+        const int value = directoryIndex * extensionCount + extension;
+        auto icon = icons_.find(fileName.left(dot));
+        if(icon == icons_.end()) {
+            icons_.insert(fileName.left(dot), value);
+            used = true;
+        } else if(icon.value() / extensionCount == directoryIndex && value < icon.value()) {
+            icon.value() = value;
+        }
+    }
+
+    if(used) {
+        directories_ << directory;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+namespace XWindowSwitcher {
+
+    /*
+     * Snapshot of an XDG icon theme and the themes it inherits from. Unlike
+     * XDG::IconLookup it keeps no cache of its own, so a fresh instance sees
+     * the icons as they are on disk now. The icon directories are listed once
+     * on construction, lookups do not touch the disk. Immutable, hence thread
+     * safe, which is why all icons are resolved through it.
+     */
+    class IconTheme {
+        public:
+
+            // Lists the theme directories, expensive, construct off the main thread
+            explicit IconTheme(const QString &name, const QString &fallbackIconName = QString());
+
+            const QString &name() const { return name_; }
+
+            // What the fallback icon resolved to, for anything without an icon
+            const QString &fallbackIconPath() const { return fallbackIconPath_; }
+
+            // The theme directories containing an index.theme, the chain included
+            const QStringList &roots() const { return roots_; }
+
+            /*
+             * Themes are searched in inheritance order, within a theme scalable
+             * icons win, then the largest size, like XDG::IconLookup does.
+             * @return The path of the icon or a null string
+             */
+            QString lookup(const QString &iconName) const;
+
+        private:
+
+            void addDirectory(const QString &directory);
+
+            QString name_;
+            QStringList roots_;
+            QStringList directories_;   // Icon directories in lookup order
+            QHash<QString, int> icons_; // Icon name to its directory index times the extension count plus the extension index
+            QString fallbackIconPath_;
+    };
+}
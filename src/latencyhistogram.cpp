@@ -0,0 +1,42 @@
+#include <QJsonArray>
+#include "latencyhistogram.h"
+
+/** ***************************************************************************/
+void XWindowSwitcher::LatencyHistogram::record(qint64 nsecs) {
+    quint64 usecs = nsecs < 0 ? 0 : static_cast<quint64>(nsecs) / 1000;
+
+    // Bucket i holds durations up to 2^i us
+    int bucket = 0;
+    while(bucket < BUCKETS - 1 && usecs > (quint64(1) << bucket)) {
+        bucket++;
+    }
+
+    buckets_[static_cast<size_t>(bucket)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(usecs, std::memory_order_relaxed);
+
+    quint64 maximum = maximum_.load(std::memory_order_relaxed);
+    while(usecs > maximum && !maximum_.compare_exchange_weak(maximum, usecs, std::memory_order_relaxed));
+}
+
+
+
+/** ***************************************************************************/
+QJsonObject XWindowSwitcher::LatencyHistogram::toJson() const {
+    // Counters are read one by one, concurrent records may skew them slightly
+    QJsonArray buckets;
+    for(int i = 0; i < BUCKETS; i++) {
+        QJsonObject bucket;
+        bucket["le_us"] = i == BUCKETS - 1 ? QJsonValue(QStringLiteral("inf")) : QJsonValue(double(quint64(1) << i));
+        bucket["count"] = double(buckets_[static_cast<size_t>(i)].load(std::memory_order_relaxed));
+        buckets.append(bucket);
+    }
+
+    quint64 count = count_.load(std::memory_order_relaxed);
+    QJsonObject histogram;
+    histogram["count"] = double(count);
+    histogram["mean_us"] = count == 0 ? 0.0 : double(sum_.load(std::memory_order_relaxed)) / count;
+    histogram["max_us"] = double(maximum_.load(std::memory_order_relaxed));
+    histogram["buckets"] = buckets;
+    return histogram;
+}
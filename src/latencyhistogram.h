@@ -0,0 +1,28 @@
+#pragma once
+#include <QJsonObject>
+#include <array>
+#include <atomic>
+
+namespace XWindowSwitcher {
+
+    /*
+     * Lock free histogram of durations in power of two microsecond buckets,
+     * the last one collects everything above. Recording is a few relaxed
+     * atomic increments, so it can be done on the query path. Thread safe.
+     */
+    class LatencyHistogram {
+        public:
+
+            static const int BUCKETS = 22;  // Up to ~1 s
+
+            void record(qint64 nsecs);
+            QJsonObject toJson() const;
+
+        private:
+
+            std::array<std::atomic<quint64>, BUCKETS> buckets_{};
+            std::atomic<quint64> count_{0};
+            std::atomic<quint64> sum_{0};      // In microseconds
+            std::atomic<quint64> maximum_{0};  // In microseconds
+    };
+}
@@ -0,0 +1,129 @@
+#include <QSettings>
+#include "matcher.h"
+
+const char *XWindowSwitcher::Matcher::CFG_MIN_QUERY_LENGTH = "minimumQueryLength";
+const char *XWindowSwitcher::Matcher::CFG_EXCLUDED_CLASSES = "excludedClasses";
+const char *XWindowSwitcher::Matcher::CFG_SEARCH_TITLES = "searchTitles";
+const char *XWindowSwitcher::Matcher::CFG_MAX_RESULTS = "maximumResults";
+const char *XWindowSwitcher::Matcher::CFG_PARALLEL_THRESHOLD = "parallelThreshold";
+const char *XWindowSwitcher::Matcher::CFG_GROUP_BY_CLASS = "groupByClass";
+const char *XWindowSwitcher::Matcher::CFG_CURRENT_DESKTOP_ONLY = "currentDesktopOnly";
+const char *XWindowSwitcher::Matcher::CFG_EXCLUDE_SKIP_TASKBAR = "excludeSkipTaskbar";
+const char *XWindowSwitcher::Matcher::CFG_FUZZY_DISTANCE = "fuzzyDistance";
+
+const int XWindowSwitcher::Matcher::DEF_MIN_QUERY_LENGTH = 2;
+const bool XWindowSwitcher::Matcher::DEF_SEARCH_TITLES = true;
+const int XWindowSwitcher::Matcher::DEF_MAX_RESULTS = 0;
+const int XWindowSwitcher::Matcher::DEF_PARALLEL_THRESHOLD = 512;
+const bool XWindowSwitcher::Matcher::DEF_GROUP_BY_CLASS = false;
+const bool XWindowSwitcher::Matcher::DEF_CURRENT_DESKTOP_ONLY = false;
+const bool XWindowSwitcher::Matcher::DEF_EXCLUDE_SKIP_TASKBAR = false;
+const int XWindowSwitcher::Matcher::DEF_FUZZY_DISTANCE = 0;
+const int XWindowSwitcher::Matcher::MAX_FUZZY_DISTANCE;
+
+/** ***************************************************************************/
+XWindowSwitcher::Matcher::Matcher()
+    : minimumQueryLength_(DEF_MIN_QUERY_LENGTH), searchTitles_(DEF_SEARCH_TITLES), maximumResults_(DEF_MAX_RESULTS),
+      parallelThreshold_(DEF_PARALLEL_THRESHOLD), groupByClass_(DEF_GROUP_BY_CLASS),
+      currentDesktopOnly_(DEF_CURRENT_DESKTOP_ONLY), excludeSkipTaskbar_(DEF_EXCLUDE_SKIP_TASKBAR), fuzzyDistance_(DEF_FUZZY_DISTANCE) {
+
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::Matcher::Matcher(const QSettings &settings) : Matcher() {
+    minimumQueryLength_ = qMax(1, settings.value(CFG_MIN_QUERY_LENGTH, DEF_MIN_QUERY_LENGTH).toInt());
+    searchTitles_ = settings.value(CFG_SEARCH_TITLES, DEF_SEARCH_TITLES).toBool();
+    maximumResults_ = qMax(0, settings.value(CFG_MAX_RESULTS, DEF_MAX_RESULTS).toInt());
+    parallelThreshold_ = qMax(0, settings.value(CFG_PARALLEL_THRESHOLD, DEF_PARALLEL_THRESHOLD).toInt());
+    groupByClass_ = settings.value(CFG_GROUP_BY_CLASS, DEF_GROUP_BY_CLASS).toBool();
+    currentDesktopOnly_ = settings.value(CFG_CURRENT_DESKTOP_ONLY, DEF_CURRENT_DESKTOP_ONLY).toBool();
+    excludeSkipTaskbar_ = settings.value(CFG_EXCLUDE_SKIP_TASKBAR, DEF_EXCLUDE_SKIP_TASKBAR).toBool();
+    fuzzyDistance_ = qBound(0, settings.value(CFG_FUZZY_DISTANCE, DEF_FUZZY_DISTANCE).toInt(), MAX_FUZZY_DISTANCE);
+
+    /*
+     * Plain class names go into a hash set. Entries using the wildcards * and ?
+     * are translated to a single anchored alternation compiled once.
+     */
+    QStringList patterns;
+    for(QString excludedClass : settings.value(CFG_EXCLUDED_CLASSES).toStringList()) {
+        excludedClass = excludedClass.trimmed().toLower();
+        if(excludedClass.isEmpty()) {
+            continue;
+        }
+
+        if(excludedClass.contains('*') || excludedClass.contains('?')) {
+            patterns << QRegularExpression::escape(excludedClass)
+                .replace("\\*", ".*")
+                .replace("\\?", ".");
+        } else {
+            excludedClasses_.insert(excludedClass);
+        }
+    }
+
+    if(!patterns.isEmpty()) {
+        excludedPatterns_ = QRegularExpression(QString("^(?:%1)$").arg(patterns.join('|')));
+        excludedPatterns_.optimize();
+    }
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::Matcher::isExcluded(const QString &windowClass) const {
+    if(excludedClasses_.contains(windowClass)) {
+        return true;
+    }
+    return !excludedPatterns_.pattern().isEmpty() && excludedPatterns_.match(windowClass).hasMatch();
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::Matcher::matches(const QString &foldedClass, const FoldedText &foldedTitle, const QString &searchText,
+                                       const QString &foldedQuery, int *titlePosition) const {
+    *titlePosition = searchTitles_ ? foldedTitle.originalPosition(foldedTitle.text().indexOf(foldedQuery)) : -1;
+    return *titlePosition != -1
+        || foldedClass.contains(foldedQuery)
+        || searchText.contains(foldedQuery);
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::FuzzyPattern XWindowSwitcher::Matcher::fuzzyPattern(const QString &foldedQuery) const {
+    // One edit per four characters at most, short queries would match almost anything
+    return FuzzyPattern(foldedQuery, qMin(fuzzyDistance_, foldedQuery.size() / 4));
+}
+
+
+
+/** ***************************************************************************/
+int XWindowSwitcher::Matcher::fuzzyMatches(const QString &foldedClass, const FoldedText &foldedTitle, const QString &searchText,
+                                           const FuzzyPattern &pattern, int *titlePosition) const {
+    *titlePosition = -1;
+    if(pattern.isNull()) {
+        return -1;
+    }
+
+    // Nothing matched exactly, so 1 is the best any of them can do
+    int best = -1;
+    if(searchTitles_) {
+        int end;
+        best = pattern.distance(foldedTitle.text(), &end);
+        if(best != -1) {
+            *titlePosition = foldedTitle.originalPosition(qMax(0, end - pattern.length()));
+        }
+    }
+    for(const QString *text : {&foldedClass, &searchText}) {
+        if(best == 1) {
+            break;
+        }
+        int distance = pattern.distance(*text);
+        if(distance != -1 && (best == -1 || distance < best)) {
+            best = distance;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <QRegularExpression>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include "foldedtext.h"
+#include "fuzzypattern.h"
+
+class QSettings;
+
+namespace XWindowSwitcher {
+
+    /*
+     * Immutable matching configuration compiled from the plugin settings.
+     * Queries grab a shared pointer to the current instance, so settings
+     * changes never touch the query path.
+     */
+    class Matcher {
+        public:
+
+            static const char *CFG_MIN_QUERY_LENGTH;
+            static const char *CFG_EXCLUDED_CLASSES;
+            static const char *CFG_SEARCH_TITLES;
+            static const char *CFG_MAX_RESULTS;
+            static const char *CFG_PARALLEL_THRESHOLD;
+            static const char *CFG_GROUP_BY_CLASS;
+            static const char *CFG_CURRENT_DESKTOP_ONLY;
+            static const char *CFG_EXCLUDE_SKIP_TASKBAR;
+            static const char *CFG_FUZZY_DISTANCE;
+
+            static const int DEF_MIN_QUERY_LENGTH;
+            static const bool DEF_SEARCH_TITLES;
+            static const int DEF_MAX_RESULTS;
+            static const int DEF_PARALLEL_THRESHOLD;
+            static const bool DEF_GROUP_BY_CLASS;
+            static const bool DEF_CURRENT_DESKTOP_ONLY;
+            static const bool DEF_EXCLUDE_SKIP_TASKBAR;
+            static const int DEF_FUZZY_DISTANCE;
+
+            static const int MAX_FUZZY_DISTANCE = 3;
+
+            Matcher();
+            explicit Matcher(const QSettings &settings);
+
+            bool acceptsQuery(const QString &query) const { return query.length() >= minimumQueryLength_; }
+            bool isExcluded(const QString &windowClass) const;
+            bool searchTitles() const { return searchTitles_; }
+
+            /*
+             * Matches a window against a query, all of them folded by FoldedText.
+             * @param titlePosition Set to where the query occurs in the original title, -1 if not
+             * @return True if the title, the class or the desktop entry search text match
+             */
+            bool matches(const QString &foldedClass, const FoldedText &foldedTitle, const QString &searchText,
+                         const QString &foldedQuery, int *titlePosition) const;
+
+            /*
+             * Compiled once per query. Null if fuzzy matching is disabled or the
+             * query is too short to be matched with errors.
+             */
+            FuzzyPattern fuzzyPattern(const QString &foldedQuery) const;
+
+            /*
+             * Matches a window against a query with typos, for windows that did
+             * not match exactly.
+             * @param titlePosition Set to where the best match starts in the original title, -1 if not
+             * @return The smallest edit distance of the title, the class or the search text, -1 if none is close enough
+             */
+            int fuzzyMatches(const QString &foldedClass, const FoldedText &foldedTitle, const QString &searchText,
+                             const FuzzyPattern &pattern, int *titlePosition) const;
+
+            // Maximum number of results per query, 0 means unlimited
+            int maximumResults() const { return maximumResults_; }
+
+            // Window count of all displays together from which matching is split across threads, 0 disables it
+            int parallelThreshold() const { return parallelThreshold_; }
+
+            // One item per window class instead of one per window
+            bool groupByClass() const { return groupByClass_; }
+
+            // Filters applied before matching
+            bool currentDesktopOnly() const { return currentDesktopOnly_; }
+            bool excludeSkipTaskbar() const { return excludeSkipTaskbar_; }
+
+            // Edits allowed in a fuzzy match, 0 disables fuzzy matching
+            int fuzzyDistance() const { return fuzzyDistance_; }
+
+        private:
+
+            int minimumQueryLength_;
+            bool searchTitles_;
+            int maximumResults_;
+            int parallelThreshold_;
+            bool groupByClass_;
+            bool currentDesktopOnly_;
+            bool excludeSkipTaskbar_;
+            int fuzzyDistance_;
+            QSet<QString> excludedClasses_;
+            QRegularExpression excludedPatterns_;
+    };
+}
@@ -0,0 +1,138 @@
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QStandardPaths>
+#include <climits>
+#include <unistd.h>
+#include "pidresolver.h"
+#include "xproperty.h"
+
+#define MAX_SCRIPT_ARGUMENTS 4
+
+/** ***************************************************************************/
+QString XWindowSwitcher::PidResolver::resolve(int display, Window window, pid_t pid, const QHash<QString, QString> &executables) {
+    if(pid <= 0) {
+        return QString();
+    }
+
+    const QPair<int, Window> id(display, window);
+    {
+        QMutexLocker locker(&mutex);
+        auto it = cache.find(id);
+        if(it != cache.end() && it.value().pid == pid) {
+            return it.value().key;
+        }
+    }
+
+    QString key = lookup(pid, executables);
+
+    QMutexLocker locker(&mutex);
+    cache.insert(id, Resolution{pid, key});
+    return key;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::PidResolver::retain(const std::vector<std::shared_ptr<const WindowSnapshot>> &snapshots) {
+    size_t windows = 0;
+    for(const auto &snapshot : snapshots) {
+        windows += snapshot->windows.size();
+    }
+
+    QMutexLocker locker(&mutex);
+
+    // Nothing can be stale if all cached windows may still exist
+    if(static_cast<size_t>(cache.size()) <= windows) {
+        return;
+    }
+
+    QSet<QPair<int, Window>> alive;
+    alive.reserve(static_cast<int>(windows));
+    for(size_t display = 0; display < snapshots.size(); display++) {
+        for(const WindowRecord &record : snapshots[display]->windows) {
+            alive.insert(qMakePair(static_cast<int>(display), record.window));
+        }
+    }
+
+    for(auto it = cache.begin(); it != cache.end();) {
+        if(!alive.contains(it.key())) {
+            it = cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::PidResolver::clear() {
+    QMutexLocker locker(&mutex);
+    cache.clear();
+}
+
+
+
+/** ***************************************************************************/
+pid_t XWindowSwitcher::PidResolver::windowPid(const XProperty &clientMachine, const XProperty &netWmPid) {
+    // A pid is only meaningful for clients running on this machine
+    if(clientMachine.isValid()) {
+        char hostname[HOST_NAME_MAX + 1] = {0};
+        gethostname(hostname, HOST_NAME_MAX);
+        QString client = clientMachine.text();
+        QString host = QString::fromLocal8Bit(hostname);
+        if(client.section('.', 0, 0) != host.section('.', 0, 0)) {
+            return 0;
+        }
+    }
+
+    unsigned long pid = 0;
+    netWmPid.cardinal(&pid);
+    return static_cast<pid_t>(pid);
+}
+
+
+
+/** ***************************************************************************/
+QString XWindowSwitcher::PidResolver::lookup(pid_t pid, const QHash<QString, QString> &executables) {
+    const QString proc = QString("/proc/%1/").arg(pid);
+
+    QList<QByteArray> arguments;
+    QFile cmdline(proc + "cmdline");
+    if(cmdline.open(QIODevice::ReadOnly)) {
+        arguments = cmdline.readAll().split('\0');
+    }
+
+    // Scripts and jars first, the interpreter running them is not specific
+    for(int i = 1; i < arguments.size() && i <= MAX_SCRIPT_ARGUMENTS; i++) {
+        if(arguments[i].startsWith('/')) {
+            QString key = executables.value(QFileInfo(QFile::decodeName(arguments[i])).canonicalFilePath());
+            if(!key.isNull()) {
+                return key;
+            }
+        }
+    }
+
+    QString exe = QFile::symLinkTarget(proc + "exe");
+    if(exe.endsWith(" (deleted)")) {
+        exe.chop(10);
+    }
+    QString key = executables.value(exe);
+    if(!key.isNull()) {
+        return key;
+    }
+
+    // Wrappers exec'ing into a differently named binary keep their argv[0]
+    if(!arguments.isEmpty() && !arguments[0].isEmpty()) {
+        QString program = QFile::decodeName(arguments[0]);
+        if(!program.startsWith('/')) {
+            program = QStandardPaths::findExecutable(program);
+        }
+        if(!program.isEmpty()) {
+            return executables.value(QFileInfo(program).canonicalFilePath());
+        }
+    }
+
+    return QString();
+}
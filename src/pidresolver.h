@@ -0,0 +1,54 @@
+#pragma once
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <memory>
+#include <sys/types.h>
+#include <vector>
+#include "windowmodel.h"
+
+namespace XWindowSwitcher {
+
+    class XProperty;
+
+    /*
+     * Maps windows to desktop entries via the process owning them. The pid is
+     * taken from _NET_WM_PID and looked up by the scripts and executables in
+     * /proc/<pid>/cmdline and /proc/<pid>/exe. Results, including misses, are
+     * cached per window until the window is gone. Window ids are only unique
+     * per display, the windows are told apart by the index of the display,
+     * which is the index of its snapshot in the queries. Clear the cache when
+     * the displays change. Resolving does not talk to X, the pid is fetched
+     * by the window model. Thread safe.
+     */
+    class PidResolver {
+        public:
+
+            // The _NET_WM_PID of a local client from the replies fetched by the window model, 0 if unknown or remote
+            static pid_t windowPid(const XProperty &clientMachine, const XProperty &netWmPid);
+
+            /*
+             * @param executables Canonical executable path to desktop entry key
+             * @return The key of the desktop entry or a null string
+             */
+            QString resolve(int display, Window window, pid_t pid, const QHash<QString, QString> &executables);
+
+            // Drops the cached windows that are not in their display's snapshot anymore
+            void retain(const std::vector<std::shared_ptr<const WindowSnapshot>> &snapshots);
+
+            void clear();
+
+        private:
+
+            static QString lookup(pid_t pid, const QHash<QString, QString> &executables);
+
+            struct Resolution {
+                pid_t pid;
+                QString key;
+            };
+
+            QMutex mutex;
+            QHash<QPair<int /*display*/, Window>, Resolution> cache;
+    };
+}
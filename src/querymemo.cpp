@@ -0,0 +1,39 @@
+#include "querymemo.h"
+
+/** ***************************************************************************/
+bool XWindowSwitcher::QueryMemo::lookup(const QString &foldedQuery, quint64 generation, const std::shared_ptr<const void> &matcher, const std::shared_ptr<const void> &index, MatchList *matches) {
+    QMutexLocker locker(&mutex_);
+
+    auto it = entries_.constFind(foldedQuery);
+    if(it == entries_.constEnd() || it->generation != generation || it->matcher != matcher || it->index != index) {
+        return false;
+    }
+
+    *matches = it->matches;
+    return true;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::QueryMemo::insert(const QString &foldedQuery, quint64 generation, const std::shared_ptr<const void> &matcher, const std::shared_ptr<const void> &index, const MatchList &matches) {
+    QMutexLocker locker(&mutex_);
+
+    if(!entries_.contains(foldedQuery)) {
+        while(order_.size() >= capacity_) {
+            entries_.remove(order_.dequeue());
+        }
+        order_.enqueue(foldedQuery);
+    }
+
+    entries_.insert(foldedQuery, Entry{generation, matcher, index, matches});
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::QueryMemo::clear() {
+    QMutexLocker locker(&mutex_);
+    entries_.clear();
+    order_.clear();
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <QHash>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "albert/item.h"
+
+namespace XWindowSwitcher {
+
+    typedef std::vector<std::pair<std::shared_ptr<Core::Item>, uint>> MatchList;
+
+    /*
+     * Remembers the results of recent queries of a session. An entry is only
+     * valid for the window generation and the matcher and index instances it
+     * was computed with, so any window or configuration change invalidates it
+     * implicitly. Thread safe.
+     */
+    class QueryMemo {
+        public:
+
+            explicit QueryMemo(int capacity = 32) : capacity_(capacity) {}
+
+            bool lookup(const QString &foldedQuery, quint64 generation, const std::shared_ptr<const void> &matcher, const std::shared_ptr<const void> &index, MatchList *matches);
+            void insert(const QString &foldedQuery, quint64 generation, const std::shared_ptr<const void> &matcher, const std::shared_ptr<const void> &index, const MatchList &matches);
+            void clear();
+
+        private:
+
+            struct Entry {
+                quint64 generation;
+                std::shared_ptr<const void> matcher;   // Held to rule out address reuse
+                std::shared_ptr<const void> index;
+                MatchList matches;
+            };
+
+            const int capacity_;
+            QMutex mutex_;
+            QHash<QString, Entry> entries_;
+            QQueue<QString> order_;     // Insertion order for eviction
+    };
+}
@@ -0,0 +1,160 @@
+#include <QDebug>
+#include <QFile>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "statsserver.h"
+
+#define SEND_TIMEOUT_MS 1000
+
+/** ***************************************************************************/
+XWindowSwitcher::StatsServer::StatsServer() : listener_(-1), wakeup_(-1) {
+
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::StatsServer::~StatsServer() {
+    close();
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::StatsServer::open(const QString &path, std::function<QByteArray()> document) {
+    if(listener_ != -1) {
+        return true;
+    }
+
+    QByteArray encodedPath = QFile::encodeName(path);
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(static_cast<size_t>(encodedPath.size()) >= sizeof(address.sun_path)) {
+        qWarning() << "Socket path too long" << path;
+        return false;
+    }
+    memcpy(address.sun_path, encodedPath.constData(), static_cast<size_t>(encodedPath.size()));
+
+    listener_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listener_ == -1) {
+        qWarning() << "Cannot create socket" << strerror(errno);
+        return false;
+    }
+
+    // A previous instance may have left its socket behind
+    unlink(encodedPath.constData());
+
+    /*
+     * Only the user may read the stats, the runtime dir should ensure that
+     * too. The umask is shared by all threads of the process, so the mode is
+     * changed after binding instead, nobody can connect before listen.
+     */
+    if(bind(listener_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == -1
+            || chmod(encodedPath.constData(), S_IRUSR | S_IWUSR) == -1 || listen(listener_, 4) == -1) {
+        qWarning() << "Cannot listen on" << path << strerror(errno);
+        ::close(listener_);
+        listener_ = -1;
+        return false;
+    }
+
+    wakeup_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if(wakeup_ == -1) {
+        ::close(listener_);
+        listener_ = -1;
+        unlink(encodedPath.constData());
+        return false;
+    }
+
+    path_ = path;
+    document_ = std::move(document);
+    start();
+    return true;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::StatsServer::close() {
+    if(listener_ == -1) {
+        return;
+    }
+
+    uint64_t value = 1;
+    if(write(wakeup_, &value, sizeof(value)) != sizeof(value)) {
+        qWarning() << "Cannot wake up the stats thread";
+    }
+    wait();
+
+    ::close(listener_);
+    ::close(wakeup_);
+    unlink(QFile::encodeName(path_).constData());
+    listener_ = -1;
+    wakeup_ = -1;
+    path_.clear();
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::StatsServer::run() {
+    pollfd fds[2];
+    fds[0].fd = listener_;
+    fds[0].events = POLLIN;
+    fds[1].fd = wakeup_;
+    fds[1].events = POLLIN;
+
+    while(true) {
+        if(poll(fds, 2, -1) == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if(fds[1].revents & POLLIN) {
+            break;
+        }
+
+        if(fds[0].revents & POLLIN) {
+            int client = accept4(listener_, NULL, NULL, SOCK_CLOEXEC);
+            if(client != -1) {
+                serve(client);
+                ::close(client);
+            }
+        }
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::StatsServer::serve(int client) {
+    // A reader that does not read must not stall the thread for long
+    timeval timeout;
+    timeout.tv_sec = SEND_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (SEND_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    QByteArray data = document_();
+    const char *ptr = data.constData();
+    size_t remaining = static_cast<size_t>(data.size());
+    while(remaining > 0) {
+        ssize_t written = send(client, ptr, remaining, MSG_NOSIGNAL);
+        if(written == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        ptr += written;
+        remaining -= static_cast<size_t>(written);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QThread>
+#include <functional>
+
+namespace XWindowSwitcher {
+
+    /*
+     * Serves a JSON document on a UNIX domain socket. Every client gets the
+     * document once and is disconnected, e.g. socat - UNIX-CONNECT:<path>.
+     * The document is built on the server thread by the given function when a
+     * client connects, so nothing is computed while nobody is reading.
+     */
+    class StatsServer final : public QThread {
+        public:
+
+            StatsServer();
+            ~StatsServer() override;
+
+            // Binds the socket and starts the server thread
+            bool open(const QString &path, std::function<QByteArray()> document);
+            void close();
+
+            bool isOpen() const { return listener_ != -1; }
+            const QString &path() const { return path_; }
+
+        protected:
+
+            void run() override;
+
+        private:
+
+            void serve(int client);
+
+            QString path_;
+            int listener_;
+            int wakeup_;
+            std::function<QByteArray()> document_;
+    };
+}
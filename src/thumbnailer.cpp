@@ -0,0 +1,555 @@
+// X11 headers must be included before Qt headers, the extensions need Bool too
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#ifdef WITH_THUMBNAILS
+#include <X11/extensions/XShm.h>
+#include <X11/extensions/Xcomposite.h>
+#include <X11/extensions/Xdamage.h>
+#endif
+#undef Bool
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QSaveFile>
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <unistd.h>
+#include <vector>
+#include "thumbnailer.h"
+#include "xerrorfilter.h"
+
+using namespace std;
+
+/** ***************************************************************************/
+XWindowSwitcher::Thumbnailer::Thumbnailer(const WindowModel &windowModel)
+    : windowModel_(windowModel), display_(NULL), wakeup_(-1), damageEventBase_(0), active_(nullptr), quit_(false),
+      modelGeneration_(0), redirected_(false), session_(0), segmentId_(-1), segmentAddress_(nullptr), segmentSeg_(0), segmentSize_(0),
+      dirty_(false), snapshot_(make_shared<ThumbnailSnapshot>()) {
+
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::Thumbnailer::~Thumbnailer() {
+    close();
+}
+
+
+
+/** ***************************************************************************/
+shared_ptr<const XWindowSwitcher::ThumbnailSnapshot> XWindowSwitcher::Thumbnailer::snapshot() const {
+    return atomic_load(&snapshot_);
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::Thumbnailer::wake() const {
+    if(wakeup_ == -1) {
+        return;
+    }
+
+    uint64_t value = 1;
+    if(write(wakeup_, &value, sizeof(value)) != sizeof(value)) {
+        qWarning() << "Cannot wake up the capture thread";
+    }
+}
+
+
+
+#ifdef WITH_THUMBNAILS
+
+#define CAPTURE_INTERVAL 1000       // Minimum ms between two captures of a window
+#define RECONCILE_INTERVAL 500      // Maximum ms until window model changes are picked up
+#define THUMBNAIL_SIZE 128          // Longest side in pixels
+
+namespace {
+
+    /*
+     * Box filter over 32 bit pixels, every target pixel averages the source
+     * pixels it covers, channel by channel. The source rows of a target row
+     * are summed into column accumulators first, a plain loop over arrays
+     * which the compiler vectorizes, then the columns are averaged.
+     */
+    QImage downscale(const uchar *pixels, int stride, int width, int height, bool alpha) {
+        int longest = max(width, height);
+        int targetWidth = longest <= THUMBNAIL_SIZE ? width : max(1, width * THUMBNAIL_SIZE / longest);
+        int targetHeight = longest <= THUMBNAIL_SIZE ? height : max(1, height * THUMBNAIL_SIZE / longest);
+
+        // ZPixmaps of depth 32 hold premultiplied ARGB, the padding of depth 24 is undefined
+        QImage result(targetWidth, targetHeight, alpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+
+        const size_t channels = static_cast<size_t>(width) * 4;
+        vector<quint32> sums(channels);
+        for(int y = 0; y < targetHeight; y++) {
+            int top = static_cast<int>(qint64(y) * height / targetHeight);
+            int bottom = max(top + 1, static_cast<int>(qint64(y + 1) * height / targetHeight));
+
+            fill(sums.begin(), sums.end(), 0u);
+            quint32 *sum = sums.data();
+            for(int row = top; row < bottom; row++) {
+                const uchar *source = pixels + static_cast<size_t>(row) * static_cast<size_t>(stride);
+                for(size_t i = 0; i < channels; i++) {
+                    sum[i] += source[i];
+                }
+            }
+
+            uchar *target = result.scanLine(y);
+            for(int x = 0; x < targetWidth; x++) {
+                int left = static_cast<int>(qint64(x) * width / targetWidth);
+                int right = max(left + 1, static_cast<int>(qint64(x + 1) * width / targetWidth));
+                quint32 count = static_cast<quint32>((right - left) * (bottom - top));
+
+                for(int channel = 0; channel < 4; channel++) {
+                    quint32 total = 0;
+                    for(int column = left; column < right; column++) {
+                        total += sum[static_cast<size_t>(column) * 4 + static_cast<size_t>(channel)];
+                    }
+                    target[x * 4 + channel] = static_cast<uchar>((total + count / 2) / count);
+                }
+                if(!alpha) {
+                    target[x * 4 + 3] = 0xFF;
+                }
+            }
+        }
+        return result;
+    }
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::Thumbnailer::isSupported() {
+    return true;
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::Thumbnailer::open(const QString &displayName, const QString &directory, const atomic<bool> *active) {
+    if(display_ != NULL) {
+        return true;
+    }
+
+    QByteArray encodedName = QFile::encodeName(displayName);
+    display_ = XOpenDisplay(displayName.isNull() ? NULL : encodedName.constData());
+    if(display_ == NULL) {
+        qDebug() << "Cannot open display for the capture thread";
+        return false;
+    }
+    XErrorFilter::add(display_);
+
+    // Naming window pixmaps needs Composite 0.2
+    int eventBase, errorBase;
+    int major = 0, minor = 0;
+    if(!XCompositeQueryExtension(display_, &eventBase, &errorBase) || !XCompositeQueryVersion(display_, &major, &minor)
+            || (major == 0 && minor < 2) || !XDamageQueryExtension(display_, &damageEventBase_, &errorBase)
+            || !XShmQueryExtension(display_)) {
+        qDebug() << "Thumbnails need the Composite, Damage and MIT-SHM extensions";
+        XErrorFilter::remove(display_);
+        XCloseDisplay(display_);
+        display_ = NULL;
+        return false;
+    }
+
+    wakeup_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if(wakeup_ == -1) {
+        XErrorFilter::remove(display_);
+        XCloseDisplay(display_);
+        display_ = NULL;
+        return false;
+    }
+
+    // Window ids get reused, thumbnails of earlier runs would be wrong
+    directory_ = directory;
+    QDir(directory_).removeRecursively();
+    QDir().mkpath(directory_);
+
+    active_ = active;
+    quit_ = false;
+    modelGeneration_ = 0;
+    redirected_ = false;
+    session_ = 0;
+    start();
+    return true;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::Thumbnailer::close() {
+    if(display_ == NULL) {
+        return;
+    }
+
+    quit_ = true;
+    wake();
+    wait();
+
+    // Redirections and damage objects go away with the connection
+    XErrorFilter::remove(display_);
+    XCloseDisplay(display_);
+    ::close(wakeup_);
+    display_ = NULL;
+    wakeup_ = -1;
+
+    tracked_.clear();
+    atomic_store(&snapshot_, shared_ptr<const ThumbnailSnapshot>(make_shared<ThumbnailSnapshot>()));
+    QDir(directory_).removeRecursively();
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::Thumbnailer::run() {
+    clock_.start();
+
+    pollfd fds[2];
+    fds[0].fd = ConnectionNumber(display_);
+    fds[0].events = POLLIN;
+    fds[1].fd = wakeup_;
+    fds[1].events = POLLIN;
+
+    bool wasActive = false;
+    while(true) {
+        bool active = active_ == nullptr || active_->load();
+        if(active && !wasActive) {
+            session_++;
+            if(!redirected_) {
+                redirectAll();
+            }
+        }
+        wasActive = active;
+        reconcile();
+        while(XPending(display_)) {
+            XEvent event;
+            XNextEvent(display_, &event);
+            handleEvent(event);
+        }
+
+        // Damaged windows captured too recently wait for their interval to pass
+        int due = active ? captureDirty() : -1;
+        publish();
+        XFlush(display_);
+
+        if(poll(fds, 2, due == -1 ? RECONCILE_INTERVAL : min(due, RECONCILE_INTERVAL)) == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if(fds[1].revents & POLLIN) {
+            uint64_t value;
+            if(read(wakeup_, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+                break;
+            }
+            if(quit_.load()) {
+                break;
+            }
+        }
+        if(fds[0].revents & (POLLERR | POLLHUP)) {
+            break;
+        }
+    }
+
+    releaseSegment();
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::Thumbnailer::redirectAll() {
+    /*
+     * Redirected windows cost the server an offscreen pixmap each, so they
+     * are only redirected once thumbnails are first needed. From then on
+     * they stay redirected, undoing it after every session would make the
+     * server free and reallocate the pixmaps and repaint all windows on
+     * every open of the launcher.
+     */
+    for(auto it = tracked_.begin(); it != tracked_.end(); ++it) {
+        XCompositeRedirectWindow(display_, it.key(), CompositeRedirectAutomatic);
+    }
+    redirected_ = true;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::Thumbnailer::reconcile() {
+    shared_ptr<const WindowSnapshot> windows = windowModel_.snapshot();
+    if(windows->generation == modelGeneration_) {
+        return;
+    }
+    modelGeneration_ = windows->generation;
+
+    QHash<Window, Tracked> tracked;
+    tracked.reserve(static_cast<int>(windows->windows.size()));
+    for(const WindowRecord &record : windows->windows) {
+        auto it = tracked_.find(record.window);
+        if(it != tracked_.end()) {
+            tracked.insert(record.window, it.value());
+            tracked_.erase(it);
+            continue;
+        }
+
+        // Keeps the content off screen even without a compositing window manager
+        if(redirected_) {
+            XCompositeRedirectWindow(display_, record.window, CompositeRedirectAutomatic);
+        }
+        Tracked window;
+        window.damage = XDamageCreate(display_, record.window, XDamageReportNonEmpty);
+        tracked.insert(record.window, window);
+    }
+
+    // What is left is gone
+    for(auto it = tracked_.begin(); it != tracked_.end(); ++it) {
+        XDamageDestroy(display_, it.value().damage);
+        if(redirected_) {
+            XCompositeUnredirectWindow(display_, it.key(), CompositeRedirectAutomatic);
+        }
+        if(!it.value().path.isNull()) {
+            QFile::remove(it.value().path);
+            dirty_ = true;
+        }
+    }
+
+    tracked_.swap(tracked);
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::Thumbnailer::handleEvent(const XEvent &event) {
+    if(event.type != damageEventBase_ + XDamageNotify) {
+        return;
+    }
+
+    // Reported once until the damage gets subtracted on capture
+    const XDamageNotifyEvent &damage = reinterpret_cast<const XDamageNotifyEvent &>(event);
+    auto it = tracked_.find(damage.drawable);
+    if(it != tracked_.end()) {
+        it.value().dirty = true;
+    }
+}
+
+
+
+/** ***************************************************************************/
+int XWindowSwitcher::Thumbnailer::captureDirty() {
+    qint64 now = clock_.elapsed();
+    qint64 next = -1;
+
+    for(auto it = tracked_.begin(); it != tracked_.end(); ++it) {
+        Tracked &tracked = it.value();
+        if(!tracked.dirty) {
+            continue;
+        }
+
+        qint64 due = tracked.capturedAt == -1 ? now : tracked.capturedAt + CAPTURE_INTERVAL;
+        if(due > now) {
+            next = next == -1 ? due - now : min(next, due - now);
+            continue;
+        }
+
+        // Subtract first, damage done during the capture is reported again
+        XDamageSubtract(display_, tracked.damage, None, None);
+        tracked.dirty = false;
+        tracked.capturedAt = now;
+        if(capture(it.key(), &tracked)) {
+            dirty_ = true;
+        }
+    }
+
+    return static_cast<int>(next);
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::Thumbnailer::capture(Window window, Tracked *tracked) {
+    // Unmapped windows have no content, they keep their last thumbnail
+    XWindowAttributes attributes;
+    if(!XGetWindowAttributes(display_, window, &attributes) || attributes.map_state != IsViewable
+            || attributes.width <= 0 || attributes.height <= 0 || (attributes.depth != 24 && attributes.depth != 32)) {
+        return false;
+    }
+
+    XShmSegmentInfo segment;
+    XImage *image = XShmCreateImage(display_, attributes.visual, static_cast<unsigned>(attributes.depth), ZPixmap, nullptr,
+                                    &segment, static_cast<unsigned>(attributes.width), static_cast<unsigned>(attributes.height));
+    if(image == nullptr) {
+        return false;
+    }
+
+    // Only the common little endian xRGB layout is handled
+    bool captured = image->bits_per_pixel == 32 && image->byte_order == LSBFirst
+            && image->red_mask == 0xFF0000 && image->blue_mask == 0xFF
+            && reserveSegment(static_cast<size_t>(image->bytes_per_line) * static_cast<size_t>(image->height));
+
+    QImage thumbnail;
+    if(captured) {
+        segment.shmid = segmentId_;
+        segment.shmaddr = image->data = segmentAddress_;
+        segment.shmseg = segmentSeg_;
+        segment.readOnly = False;
+
+        // The server writes straight into the segment, nothing is copied over the socket
+        Pixmap pixmap = XCompositeNameWindowPixmap(display_, window);
+        captured = XShmGetImage(display_, pixmap, image, 0, 0, AllPlanes);
+        if(captured) {
+            thumbnail = downscale(reinterpret_cast<const uchar *>(image->data), image->bytes_per_line,
+                                  attributes.width, attributes.height, attributes.depth == 32);
+        }
+        XFreePixmap(display_, pixmap);
+    }
+
+    // The data belongs to the segment
+    image->data = nullptr;
+    XDestroyImage(image);
+    if(!captured) {
+        return false;
+    }
+
+    /*
+     * One file per window, rewritten in place. Items cache their icons by
+     * path, so the name only changes with the first capture of a session,
+     * which is when the items of the last session become stale. Replaced
+     * atomically, a reader never sees half a file.
+     */
+    QString path = tracked->session == session_
+            ? tracked->path : QString("%1/%2-%3.png").arg(directory_).arg(window, 0, 16).arg(session_);
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly) || !thumbnail.save(&file, "PNG") || !file.commit()) {
+        return false;
+    }
+    if(!tracked->path.isNull() && tracked->path != path) {
+        QFile::remove(tracked->path);
+    }
+    tracked->path = path;
+    tracked->session = session_;
+    return true;
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::Thumbnailer::reserveSegment(size_t size) {
+    if(size <= segmentSize_) {
+        return true;
+    }
+    releaseSegment();
+
+    segmentId_ = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if(segmentId_ == -1) {
+        return false;
+    }
+
+    void *address = shmat(segmentId_, nullptr, 0);
+    if(address == reinterpret_cast<void *>(-1)) {
+        shmctl(segmentId_, IPC_RMID, nullptr);
+        segmentId_ = -1;
+        return false;
+    }
+
+    XShmSegmentInfo segment;
+    segment.shmid = segmentId_;
+    segment.shmaddr = static_cast<char *>(address);
+    segment.readOnly = False;
+    bool attached = XShmAttach(display_, &segment);
+    XSync(display_, False);
+
+    // Freed once both sides detached, even if the process dies
+    shmctl(segmentId_, IPC_RMID, nullptr);
+    if(!attached) {
+        shmdt(address);
+        segmentId_ = -1;
+        return false;
+    }
+
+    segmentAddress_ = segment.shmaddr;
+    segmentSeg_ = segment.shmseg;
+    segmentSize_ = size;
+    return true;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::Thumbnailer::releaseSegment() {
+    if(segmentAddress_ == nullptr) {
+        return;
+    }
+
+    XShmSegmentInfo segment;
+    segment.shmid = segmentId_;
+    segment.shmaddr = segmentAddress_;
+    segment.shmseg = segmentSeg_;
+    segment.readOnly = False;
+    XShmDetach(display_, &segment);
+    XSync(display_, False);
+    shmdt(segmentAddress_);
+
+    segmentId_ = -1;
+    segmentAddress_ = nullptr;
+    segmentSeg_ = 0;
+    segmentSize_ = 0;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::Thumbnailer::publish() {
+    if(!dirty_) {
+        return;
+    }
+    dirty_ = false;
+
+    auto snapshot = make_shared<ThumbnailSnapshot>();
+    snapshot->generation = WindowModel::nextGeneration();
+    for(auto it = tracked_.begin(); it != tracked_.end(); ++it) {
+        if(!it.value().path.isNull()) {
+            snapshot->paths.insert(it.key(), it.value().path);
+        }
+    }
+    atomic_store(&snapshot_, shared_ptr<const ThumbnailSnapshot>(std::move(snapshot)));
+}
+
+#else
+
+/** ***************************************************************************/
+bool XWindowSwitcher::Thumbnailer::isSupported() {
+    return false;
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::Thumbnailer::open(const QString &, const QString &, const atomic<bool> *) {
+    qDebug() << "Built without thumbnail support";
+    return false;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::Thumbnailer::close() {
+
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::Thumbnailer::run() {
+
+}
+
+#endif
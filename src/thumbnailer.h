@@ -0,0 +1,99 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include <memory>
+#include "windowmodel.h"
+
+namespace XWindowSwitcher {
+
+    struct ThumbnailSnapshot {
+        quint64 generation = 0;     // From WindowModel::nextGeneration, 0 before the first capture
+        QHash<Window, QString> paths;   // PNG files named after the window and the session of their first capture
+    };
+
+    /*
+     * Keeps small thumbnails of the windows of a window model. Owns a private
+     * X connection serviced by a dedicated thread, which redirects the windows
+     * with XComposite, follows their Damage events and captures a window
+     * through a MIT-SHM segment once it got damaged, at most once per capture
+     * interval. Readers only look up the published paths, they never talk to X.
+     *
+     * Windows are only captured while the active flag is set, e.g. while the
+     * launcher is shown. Otherwise only their damage is noted, so that they
+     * get captured once active again. They are redirected the first time the
+     * flag gets set and stay redirected until closed. Every setting of the
+     * flag starts a session. Without WITH_THUMBNAILS at build time opening
+     * always fails.
+     */
+    class Thumbnailer final : public QThread {
+        public:
+
+            explicit Thumbnailer(const WindowModel &windowModel);
+            ~Thumbnailer() override;
+
+            // False if built without the Composite, Damage and MIT-SHM libraries
+            static bool isSupported();
+
+            /*
+             * Connects to the display, $DISPLAY if null, and starts the capture
+             * thread. Fails if the server lacks Composite, Damage or MIT-SHM.
+             * The directory is emptied, it holds nothing but thumbnails.
+             * @param active Owned by the caller, null means always active
+             */
+            bool open(const QString &displayName, const QString &directory, const std::atomic<bool> *active = nullptr);
+            void close();
+
+            // Makes the capture thread pick up a change of the active flag right away
+            void wake() const;
+
+            std::shared_ptr<const ThumbnailSnapshot> snapshot() const;
+
+        protected:
+
+            void run() override;
+
+        private:
+
+            struct Tracked {
+                XID damage = 0;
+                bool dirty = true;
+                qint64 capturedAt = -1;     // ms on the capture clock, -1 if never
+                QString path;
+                quint64 session = 0;        // In which the path was named, 0 if never captured
+            };
+
+            void redirectAll();
+            void reconcile();
+            void handleEvent(const XEvent &event);
+            int captureDirty();
+            bool capture(Window window, Tracked *tracked);
+            bool reserveSegment(size_t size);
+            void releaseSegment();
+            void publish();
+
+            const WindowModel &windowModel_;
+            Display *display_;
+            int wakeup_;
+            int damageEventBase_;
+            QString directory_;
+            const std::atomic<bool> *active_;
+            std::atomic<bool> quit_;
+
+            // Only touched by the capture thread
+            quint64 modelGeneration_;
+            bool redirected_;
+            quint64 session_;           // Counts the settings of the active flag, starting at 1
+            QHash<Window, Tracked> tracked_;
+            QElapsedTimer clock_;
+            int segmentId_;             // MIT-SHM segment reused by all captures, grown as needed
+            char *segmentAddress_;
+            XID segmentSeg_;
+            size_t segmentSize_;
+            bool dirty_;
+
+            std::shared_ptr<const ThumbnailSnapshot> snapshot_;     // Use atomic_load/atomic_store
+    };
+}
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include "albert/util/standarditem.h"
+#include "displayconnection.h"
+#include "windowitems.h"
+
+using namespace Core;
+using namespace std;
+
+/** ***************************************************************************/
+shared_ptr<Item> XWindowSwitcher::makeWindowItem(const Hit &hit, const QString &iconPath,
+                                                 const shared_ptr<const DisplayConnection> &connection) {
+    const QString &applicationName = hit.window->windowClass;
+
+    auto item = make_shared<StandardItem>(applicationName);
+    item->setText(QStringLiteral("Switch Windows"));   // Static data, no allocation per item
+    item->setSubtext(hit.window->title);
+    item->setIconPath(iconPath);
+    item->addAction(make_shared<ActivateWindowAction>(applicationName, connection, hit.window->window));
+    return item;
+}
+
+
+
+/** ***************************************************************************/
+shared_ptr<Item> XWindowSwitcher::makeClassItem(const Hit &best, size_t windows, const QString &iconPath,
+                                                const shared_ptr<const DisplayConnection> &connection) {
+    const QString &applicationName = best.window->windowClass;
+
+    auto item = make_shared<StandardItem>(applicationName);
+    item->setText(QString("Switch Windows (%1)").arg(windows));
+    item->setSubtext(best.window->title);
+    item->setIconPath(iconPath);
+    item->addAction(make_shared<CycleWindowsAction>(applicationName, connection, applicationName));
+    item->addAction(make_shared<ActivateWindowAction>(best.window->title, connection, best.window->window));
+    return item;
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::ActivateWindowAction::ActivateWindowAction(const QString &text, shared_ptr<const DisplayConnection> connection, Window window)
+    : StandardActionBase(text), connection(std::move(connection)), window(window) {
+
+}
+
+void XWindowSwitcher::ActivateWindowAction::activate() const {
+    // Through the display owning the window, ids are only unique per display
+    connection->activateWindow(window);
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::CycleWindowsAction::CycleWindowsAction(const QString &text, shared_ptr<const DisplayConnection> connection, const QString &windowClass)
+    : StandardActionBase(text), connection(std::move(connection)), windowClass(windowClass) {
+
+}
+
+void XWindowSwitcher::CycleWindowsAction::activate() const {
+    // Decide on the current state, the item may be older than the last switch
+    shared_ptr<const WindowSnapshot> snapshot = connection->windowModel().snapshot();
+
+    vector<const WindowRecord *> group;
+    for(const WindowRecord &window : snapshot->windows) {
+        if(window.windowClass == windowClass) {
+            group.push_back(&window);
+        }
+    }
+    if(group.empty()) {
+        return;
+    }
+
+    // Topmost first. Raising the bottommost window while the topmost one is
+    // active walks through all of them on repeated activation.
+    sort(group.begin(), group.end(), [](const WindowRecord *lhs, const WindowRecord *rhs) {
+        return lhs->stackingIndex > rhs->stackingIndex;
+    });
+    Window target = group.front()->window == snapshot->activeWindow ? group.back()->window : group.front()->window;
+
+    connection->activateWindow(target);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <QString>
+#include <memory>
+#include "albert/item.h"
+#include "albert/util/standardactions.h"
+#include "windowsearch.h"
+
+namespace XWindowSwitcher {
+
+    class DisplayConnection;
+
+    struct ActivateWindowAction : public Core::StandardActionBase {
+        public:
+            ActivateWindowAction(const QString &text, std::shared_ptr<const DisplayConnection> connection, Window window);
+            void activate() const override;
+
+        private:
+            std::shared_ptr<const DisplayConnection> connection;
+            Window window;
+    };
+
+    struct CycleWindowsAction : public Core::StandardActionBase {
+        public:
+            CycleWindowsAction(const QString &text, std::shared_ptr<const DisplayConnection> connection, const QString &windowClass);
+            void activate() const override;
+
+        private:
+            std::shared_ptr<const DisplayConnection> connection;
+            QString windowClass;
+    };
+
+    /*
+     * The items of the query results. Shared by the plugin and the CLI, so
+     * that the allocation budget of the CLI covers the items a query really
+     * builds. The connection owns the window, it may only be null if the
+     * actions never get activated.
+     */
+    std::shared_ptr<Core::Item> makeWindowItem(const Hit &hit, const QString &iconPath,
+                                               const std::shared_ptr<const DisplayConnection> &connection);
+
+    // Cycles through the windows of the class of the representative
+    std::shared_ptr<Core::Item> makeClassItem(const Hit &best, size_t windows, const QString &iconPath,
+                                              const std::shared_ptr<const DisplayConnection> &connection);
+}
@@ -0,0 +1,477 @@
+#include <QDebug>
+#include <QFile>
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "pidresolver.h"
+#include "windowmodel.h"
+#include "xerrorfilter.h"
+#include "xproperty.h"
+
+using namespace std;
+
+#define MAX_LIST_LENGTH (1 << 20)   // In 32 bit units, a million windows
+#define FETCH_BATCH_SIZE 256        // Windows whose replies are outstanding at once
+
+namespace {
+
+    // Shared by all models and thumbnailers, so that their generations can be combined
+    atomic<quint64> generations{0};
+}
+
+struct XWindowSwitcher::WindowModel::TitleRequests {
+    XProperty::Request netWmName;
+    XProperty::Request wmName;      // Legacy fallback
+};
+
+struct XWindowSwitcher::WindowModel::DesktopRequests {
+    XProperty::Request desktop;
+    XProperty::Request state;
+};
+
+struct XWindowSwitcher::WindowModel::WindowRequests {
+    TitleRequests title;
+    DesktopRequests desktop;
+    XProperty::Request windowClass;
+    XProperty::Request clientMachine;
+    XProperty::Request pid;
+};
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::WindowModel::WindowModel()
+    : display_(NULL), root_(0), wakeup_(-1), activeWindow_(0), currentDesktop_(WindowRecord::UNKNOWN_DESKTOP), dirty_(false), roundTrips_(0), snapshot_(make_shared<WindowSnapshot>()) {
+
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::WindowModel::~WindowModel() {
+    close();
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::WindowModel::open(const QString &displayName) {
+    if(display_ != NULL) {
+        return true;
+    }
+
+    QByteArray encodedName = QFile::encodeName(displayName);
+    display_ = XOpenDisplay(displayName.isNull() ? NULL : encodedName.constData());
+    if(display_ == NULL) {
+        qDebug() << "Cannot open display for the event thread";
+        return false;
+    }
+
+    wakeup_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if(wakeup_ == -1) {
+        XCloseDisplay(display_);
+        display_ = NULL;
+        return false;
+    }
+
+    XErrorFilter::add(display_);
+
+    root_ = DefaultRootWindow(display_);
+    netClientList_ = XInternAtom(display_, "_NET_CLIENT_LIST", False);
+    netClientListStacking_ = XInternAtom(display_, "_NET_CLIENT_LIST_STACKING", False);
+    netActiveWindow_ = XInternAtom(display_, "_NET_ACTIVE_WINDOW", False);
+    netWmName_ = XInternAtom(display_, "_NET_WM_NAME", False);
+    netWmPid_ = XInternAtom(display_, "_NET_WM_PID", False);
+    utf8String_ = XInternAtom(display_, "UTF8_STRING", False);
+    netCurrentDesktop_ = XInternAtom(display_, "_NET_CURRENT_DESKTOP", False);
+    netWmDesktop_ = XInternAtom(display_, "_NET_WM_DESKTOP", False);
+    netWmState_ = XInternAtom(display_, "_NET_WM_STATE", False);
+    netWmStateSkipTaskbar_ = XInternAtom(display_, "_NET_WM_STATE_SKIP_TASKBAR", False);
+
+    // Select before the initial fetch in run(), so that no change gets lost
+    XSelectInput(display_, root_, SubstructureNotifyMask | PropertyChangeMask);
+
+    start();
+    return true;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::close() {
+    if(display_ == NULL) {
+        return;
+    }
+
+    uint64_t value = 1;
+    if(write(wakeup_, &value, sizeof(value)) != sizeof(value)) {
+        qWarning() << "Cannot wake up the event thread";
+    }
+    wait();
+
+    XErrorFilter::remove(display_);
+    XCloseDisplay(display_);
+    ::close(wakeup_);
+    display_ = NULL;
+    wakeup_ = -1;
+}
+
+
+
+/** ***************************************************************************/
+shared_ptr<const XWindowSwitcher::WindowSnapshot> XWindowSwitcher::WindowModel::snapshot() const {
+    return atomic_load(&snapshot_);
+}
+
+
+
+/** ***************************************************************************/
+quint64 XWindowSwitcher::WindowModel::nextGeneration() {
+    return ++generations;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::activateWindow(Display *display, Window window) {
+    XEvent event;
+    long mask = SubstructureRedirectMask | SubstructureNotifyMask;
+
+    event.xclient.type = ClientMessage;
+    event.xclient.serial = 0;
+    event.xclient.send_event = True;
+    event.xclient.message_type = XInternAtom(display, "_NET_ACTIVE_WINDOW", False);
+    event.xclient.window = window;
+    event.xclient.format = 32;
+    event.xclient.data.l[0] = 0;
+    event.xclient.data.l[1] = 0;
+    event.xclient.data.l[2] = 0;
+    event.xclient.data.l[3] = 0;
+    event.xclient.data.l[4] = 0;
+
+    XSendEvent(display, DefaultRootWindow(display), False, mask, &event);
+    XMapRaised(display, window);
+    XSetInputFocus(display, window, RevertToNone, CurrentTime);
+    XSync(display, false);
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::run() {
+    refreshClientList();
+    refreshStacking();
+    refreshActiveWindow();
+    refreshCurrentDesktop();
+    publish();
+
+    pollfd fds[2];
+    fds[0].fd = ConnectionNumber(display_);
+    fds[0].events = POLLIN;
+    fds[1].fd = wakeup_;
+    fds[1].events = POLLIN;
+
+    while(true) {
+        // Drain everything queued, then publish once for the whole batch
+        while(XPending(display_)) {
+            XEvent event;
+            XNextEvent(display_, &event);
+            handleEvent(event);
+        }
+        publish();
+
+        if(poll(fds, 2, -1) == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if((fds[1].revents & POLLIN) || (fds[0].revents & (POLLERR | POLLHUP))) {
+            break;
+        }
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::handleEvent(const XEvent &event) {
+    switch(event.type) {
+        case PropertyNotify: {
+            const XPropertyEvent &property = event.xproperty;
+            if(property.window == root_) {
+                if(property.atom == netClientList_) {
+                    refreshClientList();
+                } else if(property.atom == netClientListStacking_) {
+                    refreshStacking();
+                } else if(property.atom == netActiveWindow_) {
+                    refreshActiveWindow();
+                } else if(property.atom == netCurrentDesktop_) {
+                    refreshCurrentDesktop();
+                }
+                break;
+            }
+
+            auto it = windows_.find(property.window);
+            if(it == windows_.end()) {
+                break;
+            }
+
+            // Titles change a lot, e.g. in terminals, refetch only what changed
+            if(property.atom == netWmName_ || property.atom == XA_WM_NAME) {
+                fetchTitle(&it.value());
+                dirty_ = true;
+            } else if(property.atom == XA_WM_CLASS || property.atom == netWmPid_) {
+                fetchWindows({&it.value()});
+                dirty_ = true;
+            } else if(property.atom == netWmDesktop_ || property.atom == netWmState_) {
+                fetchDesktop(&it.value());
+                dirty_ = true;
+            }
+            break;
+        }
+
+        case DestroyNotify:
+            if(windows_.remove(event.xdestroywindow.window) > 0) {
+                dirty_ = true;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::refreshClientList() {
+    unsigned long count;
+
+    clientList_.clear();
+    roundTrips_.fetch_add(1, memory_order_relaxed);
+    XProperty clientList(display_, root_, netClientList_, XA_WINDOW, MAX_LIST_LENGTH);
+    const uint32_t *clients = clientList.items(&count);
+    if(clients == nullptr) {
+        windows_.clear();
+        dirty_ = true;
+        return;
+    }
+
+    clientList_.assign(clients, clients + count);
+
+    QHash<Window, WindowRecord> windows;
+    windows.reserve(static_cast<int>(clientList_.size()));
+    vector<Window> added;
+    for(Window window : clientList_) {
+        auto it = windows_.find(window);
+        if(it != windows_.end()) {
+            windows.insert(window, it.value());
+        } else if(!windows.contains(window)) {
+            // New client, follow its title and lifetime from now on
+            XSelectInput(display_, window, PropertyChangeMask | StructureNotifyMask);
+            WindowRecord record;
+            record.window = window;
+            record.stackingIndex = -1;
+            windows.insert(window, record);
+            added.push_back(window);
+        }
+    }
+
+    // Nothing gets inserted anymore, the records stay where they are
+    vector<WindowRecord *> records;
+    records.reserve(added.size());
+    for(Window window : added) {
+        records.push_back(&windows[window]);
+    }
+    fetchWindows(records);
+
+    windows_.swap(windows);
+    dirty_ = true;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::refreshStacking() {
+    unsigned long count;
+
+    stacking_.clear();
+    dirty_ = true;
+    roundTrips_.fetch_add(1, memory_order_relaxed);
+    XProperty stackingList(display_, root_, netClientListStacking_, XA_WINDOW, MAX_LIST_LENGTH);
+    const uint32_t *stacking = stackingList.items(&count);
+
+    // Bottom to top order
+    stacking_.reserve(static_cast<int>(count));
+    for(unsigned long i = 0; i < count; i++) {
+        stacking_.insert(stacking[i], static_cast<int>(i));
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::refreshActiveWindow() {
+    unsigned long activeWindow = 0;
+
+    roundTrips_.fetch_add(1, memory_order_relaxed);
+    XProperty(display_, root_, netActiveWindow_, XA_WINDOW).cardinal(&activeWindow);
+    activeWindow_ = activeWindow;
+    dirty_ = true;
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::refreshCurrentDesktop() {
+    unsigned long currentDesktop;
+
+    roundTrips_.fetch_add(1, memory_order_relaxed);
+    if(XProperty(display_, root_, netCurrentDesktop_, XA_CARDINAL).cardinal(&currentDesktop)) {
+        currentDesktop_ = static_cast<long>(currentDesktop);
+    } else {
+        currentDesktop_ = WindowRecord::UNKNOWN_DESKTOP;
+    }
+    dirty_ = true;
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::WindowModel::TitleRequests XWindowSwitcher::WindowModel::requestTitle(Window window) const {
+    // WM_NAME is only needed without _NET_WM_NAME, asking for both saves a round trip
+    return TitleRequests{XProperty::Request(display_, window, netWmName_, utf8String_),
+                         XProperty::Request(display_, window, XA_WM_NAME, AnyPropertyType)};
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::readTitle(WindowRecord *record, TitleRequests &&requests) {
+    // Decoded straight from the reply into the record
+    XProperty netWmName(std::move(requests.netWmName));
+    XProperty wmName(std::move(requests.wmName));
+    record->title = netWmName.isValid() ? netWmName.text() : wmName.text();
+
+    // Once per title change instead of once per keystroke
+    record->foldedTitle = FoldedText(record->title);
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::WindowModel::DesktopRequests XWindowSwitcher::WindowModel::requestDesktop(Window window) const {
+    return DesktopRequests{XProperty::Request(display_, window, netWmDesktop_, XA_CARDINAL),
+                           XProperty::Request(display_, window, netWmState_, XA_ATOM)};
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::readDesktop(WindowRecord *record, DesktopRequests &&requests) {
+    unsigned long desktop;
+    unsigned long count;
+
+    if(!XProperty(std::move(requests.desktop)).cardinal(&desktop)) {
+        record->desktop = WindowRecord::UNKNOWN_DESKTOP;
+    } else if(desktop == 0xFFFFFFFF) {
+        record->desktop = WindowRecord::ALL_DESKTOPS;
+    } else {
+        record->desktop = static_cast<long>(desktop);
+    }
+
+    XProperty stateProperty(std::move(requests.state));
+    const uint32_t *states = stateProperty.items(&count);
+    record->skipTaskbar = false;
+    for(unsigned long i = 0; i < count; i++) {
+        if(states[i] == netWmStateSkipTaskbar_) {
+            record->skipTaskbar = true;
+        }
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::fetchTitle(WindowRecord *record) {
+    roundTrips_.fetch_add(1, memory_order_relaxed);
+    readTitle(record, requestTitle(record->window));
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::fetchDesktop(WindowRecord *record) {
+    roundTrips_.fetch_add(1, memory_order_relaxed);
+    readDesktop(record, requestDesktop(record->window));
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::fetchWindows(const vector<WindowRecord *> &records) {
+    /*
+     * All requests of a batch are sent before the first reply is waited for,
+     * so a batch costs a single round trip however many windows it has. The
+     * batches bound the replies held by the connection.
+     */
+    vector<WindowRequests> requests;
+    requests.reserve(qMin<size_t>(records.size(), FETCH_BATCH_SIZE));
+    for(size_t begin = 0; begin < records.size(); begin += FETCH_BATCH_SIZE) {
+        size_t end = qMin<size_t>(records.size(), begin + FETCH_BATCH_SIZE);
+
+        requests.clear();
+        for(size_t i = begin; i < end; i++) {
+            Window window = records[i]->window;
+            requests.push_back(WindowRequests{requestTitle(window), requestDesktop(window),
+                                              XProperty::Request(display_, window, XA_WM_CLASS, XA_STRING),
+                                              XProperty::Request(display_, window, XA_WM_CLIENT_MACHINE, XA_STRING),
+                                              XProperty::Request(display_, window, netWmPid_, XA_CARDINAL, 1)});
+        }
+        roundTrips_.fetch_add(1, memory_order_relaxed);
+
+        for(size_t i = begin; i < end; i++) {
+            WindowRecord *record = records[i];
+            WindowRequests &windowRequests = requests[i - begin];
+            readTitle(record, std::move(windowRequests.title));
+            readDesktop(record, std::move(windowRequests.desktop));
+
+            // WM_CLASS holds res_name and res_class, each null terminated
+            XProperty windowClass(std::move(windowRequests.windowClass));
+            record->windowClass = windowClass.isValid() ? windowClass.text().section(QChar('\0'), 0, 0) : QString();
+            record->lowerClass = record->windowClass.toLower();
+            record->foldedClass = FoldedText::fold(record->windowClass);
+
+            record->pid = PidResolver::windowPid(XProperty(std::move(windowRequests.clientMachine)),
+                                                 XProperty(std::move(windowRequests.pid)));
+        }
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowModel::publish() {
+    if(!dirty_) {
+        return;
+    }
+    dirty_ = false;
+
+    auto snapshot = make_shared<WindowSnapshot>();
+    snapshot->generation = nextGeneration();
+    snapshot->activeWindow = activeWindow_;
+    snapshot->currentDesktop = currentDesktop_;
+    snapshot->windows.reserve(clientList_.size());
+    for(Window window : clientList_) {
+        auto it = windows_.constFind(window);
+        if(it != windows_.constEnd()) {
+            snapshot->windows.push_back(it.value());
+            snapshot->windows.back().stackingIndex = stacking_.value(window, -1);
+        }
+    }
+
+    atomic_store(&snapshot_, shared_ptr<const WindowSnapshot>(std::move(snapshot)));
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <QHash>
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <sys/types.h>
+#include "foldedtext.h"
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+
+// Need to undef Bool because Qt headers redefine it
+#undef Bool
+
+namespace XWindowSwitcher {
+
+    struct WindowRecord {
+        static const long UNKNOWN_DESKTOP = -1;
+        static const long ALL_DESKTOPS = -2;
+
+        Window window;
+        QString windowClass;    // res_name of WM_CLASS
+        QString lowerClass;     // For desktop entry keys and exclusions
+        QString title;
+        QString foldedClass;    // Folded when the class is fetched, matching uses these
+        FoldedText foldedTitle;
+        pid_t pid;
+        int stackingIndex;      // Position in _NET_CLIENT_LIST_STACKING, higher is on top, -1 if unknown
+        long desktop = UNKNOWN_DESKTOP;     // _NET_WM_DESKTOP
+        bool skipTaskbar = false;           // _NET_WM_STATE_SKIP_TASKBAR
+    };
+
+    struct WindowSnapshot {
+        quint64 generation = 0;     // Unique across all window models, 0 before the first fetch
+        std::vector<WindowRecord> windows;  // In _NET_CLIENT_LIST order
+        Window activeWindow = 0;
+        long currentDesktop = WindowRecord::UNKNOWN_DESKTOP;    // _NET_CURRENT_DESKTOP
+
+        // Sticky windows and window managers without desktops count as current
+        bool isOnCurrentDesktop(const WindowRecord &window) const {
+            return currentDesktop == WindowRecord::UNKNOWN_DESKTOP || window.desktop == WindowRecord::UNKNOWN_DESKTOP
+                || window.desktop == WindowRecord::ALL_DESKTOPS || window.desktop == currentDesktop;
+        }
+    };
+
+    /*
+     * Owns a private X connection serviced by a dedicated thread. The thread
+     * listens to client list changes on the root window and to property
+     * changes of every client, keeps a window table up to date and publishes
+     * an immutable snapshot of it after each batch of events. Readers get a
+     * consistent view with a single atomic load and never talk to X.
+     */
+    class WindowModel final : public QThread {
+        public:
+
+            WindowModel();
+            ~WindowModel() override;
+
+            // Connects to the display, $DISPLAY if null, and starts the event thread
+            bool open(const QString &displayName = QString());
+            void close();
+
+            std::shared_ptr<const WindowSnapshot> snapshot() const;
+
+            // Unique across all models, increasing. Thread safe.
+            static quint64 nextGeneration();
+
+            // Asks the window manager to raise and focus the window
+            static void activateWindow(Display *display, Window window);
+
+            // Synchronous requests made so far, queries themselves make none
+            quint64 roundTrips() const { return roundTrips_.load(std::memory_order_relaxed); }
+
+        protected:
+
+            void run() override;
+
+        private:
+
+            // Property requests of a window, sent before any reply is waited for
+            struct TitleRequests;
+            struct DesktopRequests;
+            struct WindowRequests;
+
+            void handleEvent(const XEvent &event);
+            void refreshClientList();
+            void refreshStacking();
+            void refreshActiveWindow();
+            void refreshCurrentDesktop();
+            TitleRequests requestTitle(Window window) const;
+            void readTitle(WindowRecord *record, TitleRequests &&requests);
+            DesktopRequests requestDesktop(Window window) const;
+            void readDesktop(WindowRecord *record, DesktopRequests &&requests);
+            void fetchTitle(WindowRecord *record);
+            void fetchDesktop(WindowRecord *record);
+
+            // All properties of the windows, one round trip per batch of windows
+            void fetchWindows(const std::vector<WindowRecord *> &records);
+            void publish();
+
+            Display *display_;
+            Window root_;
+            int wakeup_;
+            Atom netClientList_;
+            Atom netClientListStacking_;
+            Atom netActiveWindow_;
+            Atom netWmName_;
+            Atom netWmPid_;
+            Atom utf8String_;
+            Atom netCurrentDesktop_;
+            Atom netWmDesktop_;
+            Atom netWmState_;
+            Atom netWmStateSkipTaskbar_;
+
+            // Only touched by the event thread
+            QHash<Window, WindowRecord> windows_;
+            std::vector<Window> clientList_;
+            QHash<Window, int> stacking_;
+            Window activeWindow_;
+            long currentDesktop_;
+            bool dirty_;
+
+            std::atomic<quint64> roundTrips_;
+
+            /*
+             * Use atomic_load/atomic_store. Not lock free, libstdc++ guards them
+             * with a spinlock from a global pool, but it is only held while the
+             * pointer is copied, readers never wait for the event thread.
+             */
+            std::shared_ptr<const WindowSnapshot> snapshot_;
+    };
+}
@@ -0,0 +1,285 @@
+#include <QPair>
+#include <QtConcurrent>
+#include <algorithm>
+#include <iterator>
+#include "desktopindex.h"
+#include "icontheme.h"
+#include "matcher.h"
+#include "windowsearch.h"
+
+using namespace std;
+
+#define MIN_CHUNK_SIZE 128
+#define CURRENT_DESKTOP_BONUS 0x8000u
+#define MAX_STACKING_SCORE 0x7FFFu
+#define DISTANCE_STEP 0x10000u      // Above any desktop and stacking score
+
+/** ***************************************************************************/
+XWindowSwitcher::IndexSnapshot::IndexSnapshot(const DesktopIndex &index)
+    : iconPaths(index.iconPaths()), searchTexts(index.searchTexts()), executables(index.executables()) {
+
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::SearchContext::setQuery(const QString &query) {
+    foldedQuery = FoldedText::fold(query);
+    fuzzyPattern = matcher->fuzzyPattern(foldedQuery);
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::HitList XWindowSwitcher::WindowSearch::search(const SearchContext &context) {
+    /*
+     * Below the threshold, counting the windows of all displays, everything
+     * is matched on this thread. Otherwise every snapshot is a chunk of its
+     * own, large ones are split further, one chunk per worker plus one for
+     * this thread, but not too small ones.
+     */
+    size_t threshold = static_cast<size_t>(context.matcher->parallelThreshold());
+    size_t total = 0;
+    for(const shared_ptr<const WindowSnapshot> &snapshot : context.windows) {
+        total += snapshot->windows.size();
+    }
+    bool parallel = threshold != 0 && total >= threshold;
+
+    vector<Chunk> chunks;
+    for(size_t source = 0; source < context.windows.size(); source++) {
+        const WindowRecord *begin = context.windows[source]->windows.data();
+        size_t size = context.windows[source]->windows.size();
+        size_t parts = 1;
+        if(parallel) {
+            parts = qMax<size_t>(1, qMin<size_t>(pool_.maxThreadCount() + 1, size / MIN_CHUNK_SIZE));
+        }
+        size_t partSize = (size + parts - 1) / parts;
+        for(size_t part = 0; part < parts && size != 0; part++) {
+            chunks.push_back(Chunk{source, begin + qMin(size, part * partSize), begin + qMin(size, (part + 1) * partSize)});
+        }
+    }
+
+    HitList hits;
+    if(!parallel || chunks.size() <= 1) {
+        for(const Chunk &chunk : chunks) {
+            matchWindows(context, chunk, &hits);
+        }
+
+    } else {
+        vector<HitList> partialHits(chunks.size());
+
+        QList<QFuture<void>> futures;
+        for(size_t chunk = 1; chunk < chunks.size(); chunk++) {
+            const Chunk *work = &chunks[chunk];
+            HitList *chunkHits = &partialHits[chunk];
+            futures << QtConcurrent::run(&pool_, [this, &context, work, chunkHits]() {
+                matchWindows(context, *work, chunkHits);
+            });
+        }
+        matchWindows(context, chunks.front(), &partialHits[0]);
+
+        for(QFuture<void> &future : futures) {
+            future.waitForFinished();
+        }
+
+        // Merge in window order, so the result does not depend on scheduling
+        size_t count = 0;
+        for(const HitList &partial : partialHits) {
+            count += partial.size();
+        }
+        hits.reserve(count);
+        for(HitList &partial : partialHits) {
+            move(partial.begin(), partial.end(), back_inserter(hits));
+        }
+    }
+
+    // Best first, ties in snapshot and window order. Grouping keeps this order for the groups.
+    auto better = [](const Hit &lhs, const Hit &rhs) {
+        if(lhs.score != rhs.score) {
+            return lhs.score > rhs.score;
+        }
+        return lhs.source != rhs.source ? lhs.source < rhs.source : lhs.window < rhs.window;
+    };
+    size_t limit = context.matcher->groupByClass() ? 0 : static_cast<size_t>(context.matcher->maximumResults());
+    if(limit != 0 && hits.size() > limit) {
+        partial_sort(hits.begin(), hits.begin() + static_cast<ptrdiff_t>(limit), hits.end(), better);
+        hits.resize(limit);
+    } else {
+        sort(hits.begin(), hits.end(), better);
+    }
+    return hits;
+}
+
+
+
+/** ***************************************************************************/
+vector<XWindowSwitcher::HitGroup> XWindowSwitcher::WindowSearch::group(const HitList &hits, const Matcher &matcher) {
+    QHash<QPair<int, QString>, int> groupIndex;
+    vector<HitGroup> groups;
+    for(const Hit &hit : hits) {
+        QPair<int, QString> group(static_cast<int>(hit.source), hit.window->windowClass);
+        auto it = groupIndex.find(group);
+        if(it == groupIndex.end()) {
+            groupIndex.insert(group, static_cast<int>(groups.size()));
+            groups.emplace_back(1, &hit);
+        } else {
+            groups[static_cast<size_t>(it.value())].push_back(&hit);
+        }
+    }
+
+    size_t limit = static_cast<size_t>(matcher.maximumResults());
+    if(limit != 0 && groups.size() > limit) {
+        groups.resize(limit);
+    }
+    return groups;
+}
+
+
+
+/** ***************************************************************************/
+const XWindowSwitcher::Hit *XWindowSwitcher::WindowSearch::representative(const HitGroup &group) {
+    return *min_element(group.begin(), group.end(), [](const Hit *lhs, const Hit *rhs) {
+        if((lhs->titlePosition == -1) != (rhs->titlePosition == -1)) {
+            return rhs->titlePosition == -1;
+        }
+        if(lhs->titlePosition != rhs->titlePosition) {
+            return lhs->titlePosition < rhs->titlePosition;
+        }
+        return lhs->window->stackingIndex > rhs->window->stackingIndex;
+    });
+}
+
+
+
+/** ***************************************************************************/
+QString XWindowSwitcher::WindowSearch::resolveKey(const IndexSnapshot &index, size_t source, const WindowRecord &window) {
+    // Prefer the desktop entry of the owning process over guessing from the class
+    QString key = pidResolver_.resolve(static_cast<int>(source), window.window, window.pid, index.executables);
+    return key.isNull() ? window.lowerClass : key;
+}
+
+
+
+/** ***************************************************************************/
+QString XWindowSwitcher::WindowSearch::iconPath(const IndexSnapshot &index, const QString &key, const QString &applicationName) {
+    QString iconPath = index.iconPaths.value(key);
+
+    // Nothing to resolve with before the theme is loaded, misses are not cached then
+    shared_ptr<const IconTheme> theme = iconTheme();
+    if(!theme) {
+        return iconPath;
+    }
+
+    // Thread safe, the cache locks and the theme is immutable
+    if(iconPath.isNull() && !iconCache_.lookup(key, &iconPath)) {
+        iconPath = theme->lookup(applicationName);
+        if(iconPath.isEmpty()) {
+            iconPath = theme->lookup(applicationName.toLower());
+        }
+        iconCache_.insert(key, iconPath);
+    }
+
+    return iconPath.isEmpty() ? theme->fallbackIconPath() : iconPath;
+}
+
+
+
+/** ***************************************************************************/
+shared_ptr<const XWindowSwitcher::SessionPrefetch> XWindowSwitcher::WindowSearch::prefetch(const SnapshotList &windows, shared_ptr<const IndexSnapshot> index,
+                                                                                           const atomic<bool> &cancelled) {
+    auto result = make_shared<SessionPrefetch>();
+    result->windows = windows;
+    result->index = std::move(index);
+
+    for(size_t source = 0; source < windows.size(); source++) {
+        result->prepared.emplace_back();
+        vector<PreparedWindow> &preparedWindows = result->prepared.back();
+        preparedWindows.reserve(windows[source]->windows.size());
+
+        for(const WindowRecord &window : windows[source]->windows) {
+            if(cancelled.load()) {
+                return nullptr;
+            }
+
+            PreparedWindow prepared;
+            prepared.key = resolveKey(*result->index, source, window);
+            iconPath(*result->index, prepared.key, window.windowClass);
+            preparedWindows.push_back(std::move(prepared));
+        }
+    }
+
+    return result;
+}
+
+
+
+/** ***************************************************************************/
+shared_ptr<const XWindowSwitcher::IconTheme> XWindowSwitcher::WindowSearch::iconTheme() const {
+    return atomic_load(&iconTheme_);
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowSearch::setIconTheme(shared_ptr<const IconTheme> iconTheme) {
+    atomic_store(&iconTheme_, std::move(iconTheme));
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::WindowSearch::matchWindows(const SearchContext &context, const Chunk &chunk, HitList *hits) {
+    const WindowSnapshot &windows = *context.windows[chunk.source];
+
+    // Strings are shared with the snapshots, growing this is the only allocation
+    hits->reserve(hits->size() + static_cast<size_t>(chunk.end - chunk.begin));
+    for(const WindowRecord *window = chunk.begin; window != chunk.end; ++window) {
+        if(context.isValid && !context.isValid()) {
+            return;
+        }
+
+        // Cheap filters on the snapshot first
+        if((context.matcher->excludeSkipTaskbar() && window->skipTaskbar)
+                || (context.matcher->currentDesktopOnly() && !windows.isOnCurrentDesktop(*window))) {
+            continue;
+        }
+
+        if(context.matcher->isExcluded(window->lowerClass)) {
+            continue;
+        }
+
+        QString key = context.prefetch ? context.prefetch->prepared[chunk.source][static_cast<size_t>(window - windows.windows.data())].key
+                                       : resolveKey(*context.index, chunk.source, *window);
+
+        int titlePosition;
+        const QString searchText = context.index->searchTexts.value(key);
+        if(context.matcher->matches(window->foldedClass, window->foldedTitle, searchText, context.foldedQuery, &titlePosition)) {
+            hits->push_back(Hit{chunk.source, window, key, titlePosition, score(windows, *window, 0)});
+            continue;
+        }
+
+        // Typos cost a full pass over the keys, only for windows that did not match
+        int distance = context.matcher->fuzzyMatches(window->foldedClass, window->foldedTitle, searchText, context.fuzzyPattern, &titlePosition);
+        if(distance != -1) {
+            hits->push_back(Hit{chunk.source, window, key, titlePosition, score(windows, *window, distance)});
+        }
+    }
+}
+
+
+
+/** ***************************************************************************/
+uint XWindowSwitcher::WindowSearch::score(const WindowSnapshot &windows, const WindowRecord &window, int distance) {
+    /*
+     * Exact matches first, then fuzzy ones by edit distance. Among those the
+     * windows on the current desktop, then the most recently raised. Kept in
+     * a low range, this only orders the windows among themselves and leaves
+     * them below good matches of other extensions, as before.
+     */
+    uint score = static_cast<uint>(Matcher::MAX_FUZZY_DISTANCE - distance) * DISTANCE_STEP;
+    score += windows.isOnCurrentDesktop(window) ? CURRENT_DESKTOP_BONUS : 0;
+    if(window.stackingIndex >= 0) {
+        score += qMin(static_cast<uint>(window.stackingIndex) + 1, MAX_STACKING_SCORE);
+    }
+    return score;
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "fuzzypattern.h"
+#include "iconcache.h"
+#include "pidresolver.h"
+#include "windowmodel.h"
+
+namespace XWindowSwitcher {
+
+    class DesktopIndex;
+    class IconTheme;
+    class Matcher;
+
+    /*
+     * The products of the desktop index the queries need. Rebuilt on the main
+     * thread and swapped atomically, so queries never see a half updated index.
+     */
+    struct IndexSnapshot {
+        IndexSnapshot() = default;
+        explicit IndexSnapshot(const DesktopIndex &index);
+
+        QMap<QString, QString> iconPaths;
+        QHash<QString, QString> searchTexts;
+        QHash<QString, QString> executables;
+    };
+
+    // Per window data the matching needs, prepared ahead of the first query
+    struct PreparedWindow {
+        QString key;        // Desktop entry key, or the lowercase class
+    };
+
+    typedef std::vector<std::shared_ptr<const WindowSnapshot>> SnapshotList;
+
+    /*
+     * Result of WindowSearch::prefetch. Only valid for the window and index
+     * snapshots it was prepared from.
+     */
+    struct SessionPrefetch {
+        SnapshotList windows;
+        std::shared_ptr<const IndexSnapshot> index;
+        std::vector<std::vector<PreparedWindow>> prepared;    // Parallel to the windows of each snapshot
+    };
+
+    struct Hit {
+        size_t source;      // Index of the snapshot
+        const WindowRecord *window;
+        QString key;        // Desktop entry key, or the lowercase class
+        int titlePosition;  // Where the query occurs in the title, -1 if not
+        uint score;
+    };
+    typedef std::vector<Hit> HitList;
+    typedef std::vector<const Hit *> HitGroup;   // Hits of one class, best first
+
+    // Everything a search needs, prepared once per query
+    struct SearchContext {
+        std::shared_ptr<const Matcher> matcher;
+        std::shared_ptr<const IndexSnapshot> index;
+        SnapshotList windows;
+        std::shared_ptr<const SessionPrefetch> prefetch;    // Null if it does not match the snapshots
+        QString foldedQuery;
+        FuzzyPattern fuzzyPattern;  // Null unless fuzzy matching applies to the query
+        std::function<bool()> isValid;  // Stops the search early once false, null if it cannot be cancelled
+
+        // Folds the query and compiles the fuzzy pattern
+        void setQuery(const QString &query);
+    };
+
+    /*
+     * The query engine shared by the plugin and the CLI: matching with the
+     * window filters, scoring, ranking, grouping and the icon lookup. Large
+     * displays are matched in chunks on a thread pool. Thread safe.
+     */
+    class WindowSearch {
+        public:
+
+            /*
+             * Matches the windows of all snapshots and ranks them, best first.
+             * Ties are broken in snapshot and window order, so the result does
+             * not depend on scheduling. Capped to the maximum results of the
+             * matcher unless it groups by class, groups are capped instead.
+             */
+            HitList search(const SearchContext &context);
+
+            /*
+             * Groups the ranked hits by snapshot and class, keeping the order in
+             * which groups were first hit, capped to the maximum results.
+             */
+            static std::vector<HitGroup> group(const HitList &hits, const Matcher &matcher);
+
+            // Earliest title match of a group, then the topmost window
+            static const Hit *representative(const HitGroup &group);
+
+            // Desktop entry key of a window of the given snapshot, its lowercase class if none is found
+            QString resolveKey(const IndexSnapshot &index, size_t source, const WindowRecord &window);
+
+            // Icon of the desktop entry, otherwise of the window class in the theme
+            QString iconPath(const IndexSnapshot &index, const QString &key, const QString &applicationName);
+
+            /*
+             * Prepares the windows for the queries of a session and warms the pid
+             * resolver and the icon cache on the way.
+             * @return Null if cancelled meanwhile
+             */
+            std::shared_ptr<const SessionPrefetch> prefetch(const SnapshotList &windows, std::shared_ptr<const IndexSnapshot> index,
+                                                            const std::atomic<bool> &cancelled);
+
+            // Null until set, the index icons are returned as they are meanwhile
+            std::shared_ptr<const IconTheme> iconTheme() const;
+            void setIconTheme(std::shared_ptr<const IconTheme> iconTheme);
+
+            IconCache &iconCache() { return iconCache_; }
+            PidResolver &pidResolver() { return pidResolver_; }
+
+        private:
+
+            // Windows of one snapshot matched in one go
+            struct Chunk {
+                size_t source;
+                const WindowRecord *begin;
+                const WindowRecord *end;
+            };
+
+            void matchWindows(const SearchContext &context, const Chunk &chunk, HitList *hits);
+            static uint score(const WindowSnapshot &windows, const WindowRecord &window, int distance);
+
+            QThreadPool pool_;
+            IconCache iconCache_;
+            PidResolver pidResolver_;
+            std::shared_ptr<const IconTheme> iconTheme_;    // Use atomic_load/atomic_store
+    };
+}
@@ -0,0 +1,56 @@
+#include <QMutex>
+#include <QSet>
+#include "xerrorfilter.h"
+
+namespace {
+
+    QMutex mutex;
+    QSet<Display *> displays;
+    XErrorHandler previousHandler = nullptr;
+    bool installed = false;
+
+    int filterErrors(Display *display, XErrorEvent *event) {
+        XErrorHandler handler;
+        {
+            QMutexLocker locker(&mutex);
+            if(displays.contains(display)) {
+                return 0;
+            }
+            handler = previousHandler;
+        }
+        return handler == nullptr ? 0 : handler(display, event);
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::XErrorFilter::add(Display *display) {
+    QMutexLocker locker(&mutex);
+    displays.insert(display);
+    if(!installed) {
+        installed = true;
+        previousHandler = XSetErrorHandler(filterErrors);
+    }
+}
+
+
+
+/** ***************************************************************************/
+void XWindowSwitcher::XErrorFilter::remove(Display *display) {
+    QMutexLocker locker(&mutex);
+    displays.remove(display);
+    if(!installed || !displays.isEmpty()) {
+        return;
+    }
+
+    // Xlib must not call into the plugin once it is unloaded
+    XErrorHandler current = XSetErrorHandler(previousHandler);
+    if(current != filterErrors) {
+        // Installed on top of the filter, it may pass errors on to it
+        XSetErrorHandler(current);
+        return;
+    }
+    installed = false;
+    previousHandler = nullptr;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <X11/Xlib.h>
+
+// Need to undef Bool because Qt headers redefine it
+#undef Bool
+
+namespace XWindowSwitcher {
+
+    /*
+     * Windows can vanish at any time between an event and the requests made
+     * in response to it. The default Xlib handler would terminate the process
+     * on the resulting BadWindow errors. Errors on the connections added here
+     * are ignored, errors on any other connection of the process go to the
+     * handler that was installed before. The filter is installed on the first
+     * add and that handler is restored when the last connection is removed,
+     * unless another one got installed on top meanwhile. Thread safe.
+     */
+    class XErrorFilter {
+        public:
+
+            static void add(Display *display);
+
+            // Call before the connection gets closed
+            static void remove(Display *display);
+    };
+}
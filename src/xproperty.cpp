@@ -0,0 +1,107 @@
+#include <cstdlib>
+#include <X11/Xlib-xcb.h>
+#include "xproperty.h"
+
+/** ***************************************************************************/
+XWindowSwitcher::XProperty::Request::Request(Display *display, Window window, Atom property, Atom type, long maxLength)
+    : connection_(XGetXCBConnection(display)), type_(type), pending_(true) {
+    // Xlib flushes its own pending requests first, the order is kept
+    sequence_ = xcb_get_property(connection_, 0, static_cast<xcb_window_t>(window), static_cast<xcb_atom_t>(property),
+                                 static_cast<xcb_atom_t>(type), 0, static_cast<uint32_t>(maxLength)).sequence;
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::XProperty::Request::Request(Request &&other) noexcept
+    : connection_(other.connection_), sequence_(other.sequence_), type_(other.type_), pending_(other.pending_) {
+    other.pending_ = false;
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::XProperty::Request::~Request() {
+    if(pending_) {
+        xcb_discard_reply(connection_, sequence_);
+    }
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::XProperty::XProperty(Request &&request)
+    : reply_(nullptr), data_(nullptr), type_(None), format_(0), count_(0) {
+    request.pending_ = false;
+
+    // Errors, e.g. BadWindow of a vanished window, come with the reply instead of going to Xlib
+    xcb_get_property_cookie_t cookie;
+    cookie.sequence = request.sequence_;
+    xcb_generic_error_t *error = nullptr;
+    reply_ = xcb_get_property_reply(request.connection_, cookie, &error);
+    free(error);
+    if(reply_ == nullptr) {
+        return;
+    }
+
+    type_ = reply_->type;
+    format_ = reply_->format;
+    count_ = reply_->value_len;
+    if(type_ != None && (request.type_ == AnyPropertyType || type_ == request.type_)) {
+        data_ = static_cast<const unsigned char *>(xcb_get_property_value(reply_));
+    }
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::XProperty::XProperty(Display *display, Window window, Atom property, Atom type, long maxLength)
+    : XProperty(Request(display, window, property, type, maxLength)) {
+
+}
+
+
+
+/** ***************************************************************************/
+XWindowSwitcher::XProperty::~XProperty() {
+    free(reply_);
+}
+
+
+
+/** ***************************************************************************/
+const uint32_t *XWindowSwitcher::XProperty::items(unsigned long *count) const {
+    if(data_ == nullptr || format_ != 32) {
+        *count = 0;
+        return nullptr;
+    }
+    *count = count_;
+    return reinterpret_cast<const uint32_t *>(data_);
+}
+
+
+
+/** ***************************************************************************/
+bool XWindowSwitcher::XProperty::cardinal(unsigned long *value) const {
+    unsigned long count;
+    const uint32_t *values = items(&count);
+    if(count == 0) {
+        return false;
+    }
+    *value = values[0];
+    return true;
+}
+
+
+
+/** ***************************************************************************/
+QString XWindowSwitcher::XProperty::text() const {
+    if(data_ == nullptr || format_ != 8) {
+        return QString();
+    }
+
+    // Text properties are not null terminated, the length is the item count
+    const char *chars = reinterpret_cast<const char *>(data_);
+    int length = static_cast<int>(count_);
+    return type_ == XA_STRING ? QString::fromLatin1(chars, length) : QString::fromUtf8(chars, length);
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <QString>
+#include <cstdint>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#include <xcb/xcb.h>
+
+// Need to undef Bool because Qt headers redefine it
+#undef Bool
+
+namespace XWindowSwitcher {
+
+    /*
+     * Owns the reply of a single GetProperty request and gives typed views
+     * straight into the reply buffer, which is released when the property
+     * goes out of scope. A property of another type than the requested one
+     * (unless AnyPropertyType was asked for) is invalid.
+     *
+     * The requests go through the XCB connection beneath Xlib, so that they
+     * can be pipelined: a Request is sent right away and its reply is only
+     * waited for by the XProperty made from it. Sending all requests of a
+     * batch first costs a single round trip for the whole batch.
+     */
+    class XProperty {
+        public:
+
+            static const long DEFAULT_LENGTH = 1024;    // In 32 bit units, 4 kB
+
+            // A sent request, its reply is discarded unless an XProperty is made from it
+            class Request {
+                public:
+
+                    Request(Display *display, Window window, Atom property, Atom type, long maxLength = DEFAULT_LENGTH);
+                    Request(Request &&other) noexcept;
+                    ~Request();
+
+                    Request(const Request &) = delete;
+                    Request &operator=(const Request &) = delete;
+
+                private:
+
+                    friend class XProperty;
+
+                    xcb_connection_t *connection_;
+                    unsigned int sequence_;
+                    Atom type_;
+                    bool pending_;
+            };
+
+            // Waits for the reply of the request
+            explicit XProperty(Request &&request);
+
+            // Sends the request and waits for the reply, a round trip
+            XProperty(Display *display, Window window, Atom property, Atom type, long maxLength = DEFAULT_LENGTH);
+            ~XProperty();
+
+            XProperty(const XProperty &) = delete;
+            XProperty &operator=(const XProperty &) = delete;
+
+            bool isValid() const { return data_ != nullptr; }
+            Atom type() const { return type_; }
+
+            /*
+             * Format 32 items (CARDINAL, WINDOW, ATOM), 32 bits each unlike the
+             * arrays of long Xlib hands out.
+             * @return Null if the property is invalid or of another format
+             */
+            const uint32_t *items(unsigned long *count) const;
+
+            // @return True if the property holds at least one format 32 item
+            bool cardinal(unsigned long *value) const;
+
+            // Decodes format 8 text, STRING as Latin-1 and anything else as UTF-8
+            QString text() const;
+
+        private:
+
+            xcb_get_property_reply_t *reply_;
+            const unsigned char *data_;
+            Atom type_;
+            int format_;
+            unsigned long count_;
+    };
+}
@@ -0,0 +1,94 @@
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include "desktopindex.h"
+#include "icontheme.h"
+
+/*
+ * Checks the Exec tokenizer and that the keys of the main group of a desktop
+ * entry are not overridden by its action groups.
+ */
+
+using namespace std;
+using namespace XWindowSwitcher;
+
+namespace {
+
+    QTextStream err(stderr);
+
+    bool check(bool condition, const QString &what) {
+        if(!condition) {
+            err << "Failed: " << what << endl;
+        }
+        return condition;
+    }
+
+    bool checkTokens(const QString &value, const QStringList &expected) {
+        QStringList tokens = DesktopIndex::tokenizeExec(value);
+        return check(tokens == expected, QString("tokenizing %1 gave [%2]").arg(value, tokens.join("] [")));
+    }
+
+    DesktopEntry parse(const QTemporaryDir &dir, const QString &contents, const IconTheme &iconTheme) {
+        QString path = dir.filePath("test.desktop");
+        QFile file(path);
+        if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            return DesktopEntry();
+        }
+        file.write(contents.toUtf8());
+        file.close();
+        return DesktopIndex::parse(path, "test.desktop", 0, 0, iconTheme, QStringList());
+    }
+}
+
+int main() {
+    int failures = 0;
+
+    failures += checkTokens("VirtualBox %U", {"VirtualBox", "%U"}) ? 0 : 1;
+    failures += checkTokens("\"/opt/my app/run\" --name=\"a \\\"b\\\"\"", {"/opt/my app/run", "--name=a \"b\""}) ? 0 : 1;
+    failures += checkTokens("env FOO=1 BAR=2 /usr/bin/app\\s--flag", {"env", "FOO=1", "BAR=2", "/usr/bin/app", "--flag"}) ? 0 : 1;
+    failures += checkTokens("app \"unterminated", {"app", "unterminated"}) ? 0 : 1;
+
+    QTemporaryDir dir;
+    if(!dir.isValid()) {
+        err << "Cannot create a temporary directory" << endl;
+        return 1;
+    }
+    // Absolute icon paths are taken as they are, the theme is not consulted
+    IconTheme iconTheme("hicolor");
+
+    // An action group with an icon, a name and a NoDisplay key of its own
+    DesktopEntry entry = parse(dir, "[Desktop Entry]\n"
+                                    "Type=Application\n"
+                                    "Name=Virtual Machines\n"
+                                    "Exec=VirtualBox %U\n"
+                                    "Icon=/opt/virtualbox/virtualbox.png\n"
+                                    "Actions=new;\n"
+                                    "\n"
+                                    "[Desktop Action new]\n"
+                                    "Name=New Machine\n"
+                                    "Exec=VirtualBox --new\n"
+                                    "Icon=/opt/virtualbox/new.png\n"
+                                    "NoDisplay=true\n", iconTheme);
+    failures += check(entry.visible, "an action group hid the application") ? 0 : 1;
+    failures += check(entry.iconPath == "/opt/virtualbox/virtualbox.png", "icon " + entry.iconPath) ? 0 : 1;
+    failures += check(entry.key == "virtualbox", "key " + entry.key) ? 0 : 1;
+    failures += check(entry.nameTokens == QStringList{"virtual", "machines"}, "name " + entry.nameTokens.join(' ')) ? 0 : 1;
+
+    // The type of an action group does not make a link an application
+    entry = parse(dir, "[Desktop Entry]\n"
+                       "Type=Link\n"
+                       "Name=Manual\n"
+                       "Exec=manual\n"
+                       "Icon=/opt/manual.png\n"
+                       "[Desktop Action open]\n"
+                       "Type=Application\n", iconTheme);
+    failures += check(!entry.visible, "a link was indexed") ? 0 : 1;
+
+    if(failures != 0) {
+        err << failures << " failures" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <QString>
+#include <QTextStream>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "fuzzypattern.h"
+
+/*
+ * Checks the bit-parallel FuzzyPattern against the textbook dynamic program
+ * for approximate substring matching on random patterns and texts, over
+ * ASCII and other code units and up to the maximum pattern length.
+ */
+
+using namespace std;
+using namespace XWindowSwitcher;
+
+#define RANDOM_CASES 20000
+#define MAX_TEXT_LENGTH 160
+
+namespace {
+
+    QTextStream err(stderr);
+
+    struct Expected {
+        int distance;   // -1 if none
+        int end;
+    };
+
+    /*
+     * Sellers' algorithm: the first row is zero, so a match may start
+     * anywhere, the best of the last row is the distance of the pattern to
+     * its closest substring. Like FuzzyPattern, the empty match does not
+     * count and the earliest end wins.
+     */
+    Expected levenshtein(const QString &pattern, const QString &text, int maximumDistance) {
+        const int m = pattern.size();
+        vector<int> column(static_cast<size_t>(m) + 1);
+        for(int i = 0; i <= m; i++) {
+            column[static_cast<size_t>(i)] = i;
+        }
+
+        Expected expected{m, -1};
+        for(int j = 0; j < text.size(); j++) {
+            int diagonal = column[0];
+            column[0] = 0;
+            for(int i = 1; i <= m; i++) {
+                int above = column[static_cast<size_t>(i)];
+                int substitution = diagonal + (pattern[i - 1] == text[j] ? 0 : 1);
+                column[static_cast<size_t>(i)] = min({substitution, above + 1, column[static_cast<size_t>(i) - 1] + 1});
+                diagonal = above;
+            }
+            if(column[static_cast<size_t>(m)] < expected.distance) {
+                expected = Expected{column[static_cast<size_t>(m)], j + 1};
+            }
+        }
+
+        if(expected.end == -1 || expected.distance > maximumDistance) {
+            return Expected{-1, -1};
+        }
+        return expected;
+    }
+
+    QString randomString(mt19937 &random, int length) {
+        // Few distinct units, so that near matches are common, some beyond ASCII
+        static const QString alphabet = QString::fromUtf8("abcde é中ß");
+        uniform_int_distribution<int> unit(0, alphabet.size() - 1);
+        QString result;
+        result.reserve(length);
+        for(int i = 0; i < length; i++) {
+            result.append(alphabet[unit(random)]);
+        }
+        return result;
+    }
+
+    bool check(const QString &pattern, const QString &text, int maximumDistance) {
+        Expected expected = levenshtein(pattern, text, maximumDistance);
+        int end = -1;
+        int distance = FuzzyPattern(pattern, maximumDistance).distance(text, &end);
+        if(distance == expected.distance && (distance == -1 || end == expected.end)) {
+            return true;
+        }
+
+        err << QString("Mismatch for pattern \"%1\", text \"%2\", maximum %3: distance %4 end %5, expected %6 end %7")
+               .arg(pattern, text).arg(maximumDistance).arg(distance).arg(end).arg(expected.distance).arg(expected.end) << endl;
+        return false;
+    }
+}
+
+int main() {
+    int failures = 0;
+
+    // Null patterns never match
+    failures += FuzzyPattern(QString(), 2).distance("abc") == -1 ? 0 : 1;
+    failures += FuzzyPattern("abc", 0).distance("abc") == -1 ? 0 : 1;
+    failures += FuzzyPattern(QString(FuzzyPattern::MAX_LENGTH + 1, 'a'), 2).isNull() ? 0 : 1;
+
+    // Typical typos of window switching
+    failures += check("thunderbrid", "thunderbird", 2) ? 0 : 1;
+    failures += check("firfox", "mozilla firefox", 1) ? 0 : 1;
+    failures += check("konsloe", "konsole", 3) ? 0 : 1;
+    failures += check("abc", "", 3) ? 0 : 1;
+    failures += check("abc", "xyz", 3) ? 0 : 1;
+    failures += check(QString(FuzzyPattern::MAX_LENGTH, 'a'), QString(FuzzyPattern::MAX_LENGTH + 3, 'a'), 3) ? 0 : 1;
+
+    mt19937 random(1);
+    uniform_int_distribution<int> patternLength(1, FuzzyPattern::MAX_LENGTH);
+    uniform_int_distribution<int> shortPatternLength(1, 12);
+    uniform_int_distribution<int> textLength(0, MAX_TEXT_LENGTH);
+    uniform_int_distribution<int> maximumDistance(1, FuzzyPattern::MAX_LENGTH);
+    for(int i = 0; i < RANDOM_CASES && failures < 10; i++) {
+        // Mostly query sized patterns, every fourth up to the word size
+        QString pattern = randomString(random, i % 4 == 0 ? patternLength(random) : shortPatternLength(random));
+        QString text = randomString(random, textLength(random));
+        int maximum = i % 2 == 0 ? 1 + i % 3 : maximumDistance(random);
+        failures += check(pattern, text, maximum) ? 0 : 1;
+    }
+
+    if(failures != 0) {
+        err << failures << " failures" << endl;
+        return 1;
+    }
+    return 0;
+}